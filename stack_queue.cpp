@@ -4,366 +4,9244 @@
  * Demonstrates fundamental data structures with detailed explanations:
  * - Stack: Last-In-First-Out (LIFO) structure
  * - Queue: First-In-First-Out (FIFO) structure
+ * - RingQueue: FIFO on a power-of-two circular array
+ * - ChunkedQueue: FIFO on linked 4 KB blocks (growth never copies)
+ * - IntrusiveQueue / IntrusiveStack: Link through a hook in the element
+ * - PersistentStack / PersistentQueue: Immutable versions, O(1) snapshots
+ * - DaryHeap: 4-ary heap priority queue with decrease-key handles
+ * - MonotonicQueue: Sliding-window minimum/maximum in O(1) amortized
+ * - StaticStack / StaticQueue: constexpr fixed-capacity, never allocate
+ * - CompiledExpression: Infix compiled once, SIMD batch evaluation
+ * - SpscQueue: Lock-free single-producer/single-consumer FIFO
+ * - MappedQueue: File-backed FIFO shared between processes (POSIX only)
+ * - SpillQueue: Unbounded FIFO that spills its middle to disk past a budget
+ * - MpmcQueue: Bounded multi-producer/multi-consumer FIFO with backpressure
+ * - NumaShardedQueue: Per-NUMA-node MPMC shards, local-first dequeue
+ * - ShardedQueue: Per-producer SPSC shards for very high fan-in
+ * - BlockingQueue: Sleeping consumers with close() and batched wakeups
+ * - AsyncChannel: Bounded coroutine channel (co_await enqueue/dequeue)
+ * - Pipeline: Batched multi-stage processing with per-stage stats
+ * - ConcurrentStack: Lock-free LIFO with hazard-pointer reclamation
+ * - WorkStealingDeque + TaskScheduler: Multi-core fork/join task pool
+ * - ParallelBfs: Direction-optimizing BFS over CSR graphs
  * - Dynamic memory allocation
  * - Template-based implementation for type flexibility
  * - Error handling and edge cases
+ * - Compile-time tracing policy (logging compiled out by default)
+ * - Opt-in statistics policy: counters, high-water mark, latency histogram
+ * - Binary snapshots (serialize/deserialize) for Stack and Queue
+ * - contains/find/count and min/max/sum (AVX2/AVX-512/NEON for int)
+ * 
+ * Build:
+ *   g++ -std=c++20 -O2 -pthread stack_queue.cpp -o stack_queue
+ *   (-std=c++23 also enables the std::expected-returning variants)
+ *   (add -DSTACK_QUEUE_TRACE to make every container log by default)
+ *   (add -DSTACK_QUEUE_STATS to make every container keep counters)
+ *   (add -march=native, -mavx2 or -mavx512f for the x86 search kernels)
+ * 
+ * Run:
+ *   ./stack_queue                            demonstrations
+ *   ./stack_queue --benchmark [max_elements] micro-benchmarks vs std::
  * 
  * Author: Intermediate Projects Collection
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <ostream>
+#include <queue>
+#include <sstream>
+#include <stack>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if __has_include(<expected>)
+#include <expected>
+#endif
+
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#define STACK_QUEUE_HAVE_COROUTINES 1
+#else
+#define STACK_QUEUE_HAVE_COROUTINES 0
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define STACK_QUEUE_HAVE_MMAP 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define STACK_QUEUE_HAVE_MMAP 0
+#endif
+
+#if defined(__linux__)
+#define STACK_QUEUE_HAVE_AFFINITY 1
+#define STACK_QUEUE_HAVE_NUMA 1
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#else
+#define STACK_QUEUE_HAVE_AFFINITY 0
+#define STACK_QUEUE_HAVE_NUMA 0
+#endif
 
 using namespace std;
 
 // ============================================================================
-// STACK IMPLEMENTATION (LIFO - Last In, First Out)
+// TRACING POLICIES
 // ============================================================================
 
 /**
- * Template-based Stack class using dynamic arrays
- * Supports any data type (int, string, custom objects, etc.)
+ * Tracing policy that does nothing
+ * Every call is an empty inline function, so the optimizer removes the
+ * logging (and the I/O it would cause) from the container operations.
  */
-template <typename T>
-class Stack {
-private:
-    T* arr;              // Dynamic array to store elements
-    int topIndex;        // Index of top element (-1 if empty)
-    int capacity;        // Maximum capacity of stack
+struct NoTrace {
+    template <typename... Args>
+    static void log(const Args&...) {}
+};
+
+/**
+ * Tracing policy that reports every operation on standard output
+ * Uses '\n' rather than endl so each message does not force a flush.
+ */
+struct ConsoleTrace {
+    template <typename... Args>
+    static void log(const Args&... args) {
+        (cout << ... << args) << '\n';
+    }
+};
+
+/**
+ * Policy used when a container does not name one explicitly
+ * Production builds get NoTrace; define STACK_QUEUE_TRACE to log everywhere.
+ */
+#ifdef STACK_QUEUE_TRACE
+using DefaultTrace = ConsoleTrace;
+#else
+using DefaultTrace = NoTrace;
+#endif
+
+// ============================================================================
+// STATISTICS POLICIES (opt-in operation counters and latency histograms)
+// ============================================================================
+
+/**
+ * Read the CPU timestamp counter (rdtsc on x86, cntvct_el0 on AArch64)
+ * Falls back to steady_clock nanoseconds elsewhere. Ticks are only
+ * comparable on one machine; see estimateTimestampFrequency().
+ */
+inline uint64_t readTimestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/**
+ * Estimate readTimestamp() ticks per second by timing a short sleep
+ * Call once at startup when converting histograms to wall-clock time.
+ */
+inline double estimateTimestampFrequency(chrono::milliseconds window = chrono::milliseconds(20)) {
+    auto wallStart = chrono::steady_clock::now();
+    uint64_t tickStart = readTimestamp();
+    this_thread::sleep_for(window);
+    uint64_t tickEnd = readTimestamp();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+    return static_cast<double>(tickEnd - tickStart) / seconds;
+}
+
+/**
+ * Point-in-time copy of a container's counters, for metrics scraping
+ * For queues, insertions/removals count enqueues/dequeues and the latency
+ * histogram holds each element's enqueue-to-dequeue wait: bucket b counts
+ * waits of [2^b, 2^(b+1)) timestamp ticks (bucket 0 also holds 0 and 1).
+ */
+struct StatsSnapshot {
+    static constexpr int LATENCY_BUCKETS = 48;
+    
+    uint64_t insertions = 0;    // push/enqueue, including bulk variants
+    uint64_t removals = 0;      // pop/dequeue, including bulk variants
+    uint64_t resizes = 0;       // Storage reallocations
+    uint64_t bytesCopied = 0;   // Bytes relocated by those reallocations
+    uint64_t highWaterMark = 0; // Largest size observed
+    uint64_t latencySamples = 0;
+    uint64_t latencyHistogram[LATENCY_BUCKETS] = {};
     
     /**
-     * Resize the stack when capacity is reached
-     * Doubles the capacity and copies existing elements
+     * Upper bound (in ticks) of the bucket holding the given percentile
+     * (0 < p <= 100); 0 when no latency was recorded
      */
-    void resize() {
-        capacity *= 2;
-        T* newArr = new T[capacity];
-        
-        // Copy existing elements to new array
-        for (int i = 0; i <= topIndex; i++) {
-            newArr[i] = arr[i];
+    uint64_t latencyPercentile(double p) const {
+        if (latencySamples == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(latencySamples));
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            seen += latencyHistogram[b];
+            if (seen >= rank) return (uint64_t(1) << (b + 1)) - 1;
         }
-        
-        delete[] arr;  // Free old memory
-        arr = newArr;
-        cout << "Stack resized to capacity: " << capacity << endl;
+        return UINT64_MAX;
+    }
+};
+
+/**
+ * Statistics policy that records nothing
+ * Every hook is an empty inline function and the object is empty, so
+ * containers using it (the default) pay neither time nor space.
+ */
+struct NoStats {
+    static constexpr bool ENABLED = false;
+    
+    void onInsert(size_t, size_t) {}
+    void onRemove(size_t) {}
+    void onEnqueue(size_t, size_t) {}
+    void onDequeue(size_t) {}
+    void onClear() {}
+    void onResize(size_t) {}
+    
+    StatsSnapshot snapshot() const {
+        return StatsSnapshot();
+    }
+    
+    void reset() {}
+};
+
+/**
+ * Statistics policy that counts operations
+ * Queues additionally remember each element's enqueue timestamp (in
+ * arrival order, beside the container) and histogram the wait when it is
+ * dequeued. Not thread-safe: it shares the container's own locking rules.
+ */
+class ContainerStats {
+private:
+    StatsSnapshot counts;
+    deque<uint64_t> enqueueTimes;   // Timestamps of queued elements, FIFO
+    
+    void noteSize(size_t newSize) {
+        if (newSize > counts.highWaterMark) counts.highWaterMark = newSize;
+    }
+    
+    static int bucketFor(uint64_t ticks) {
+        int b = ticks < 2 ? 0 : 63 - __builtin_clzll(ticks);
+        return b < StatsSnapshot::LATENCY_BUCKETS ? b : StatsSnapshot::LATENCY_BUCKETS - 1;
     }
     
 public:
-    /**
-     * Constructor: Initialize empty stack with given capacity
-     */
-    Stack(int size = 10) {
-        arr = new T[size];
-        capacity = size;
-        topIndex = -1;  // Empty stack
-        cout << "Stack created with capacity: " << capacity << endl;
+    static constexpr bool ENABLED = true;
+    
+    // Stack hooks: n elements added (size is now newSize) or removed
+    void onInsert(size_t n, size_t newSize) {
+        counts.insertions += n;
+        noteSize(newSize);
     }
     
-    /**
-     * Destructor: Clean up dynamic memory
-     */
-    ~Stack() {
-        delete[] arr;
-        cout << "Stack destroyed" << endl;
+    void onRemove(size_t n) {
+        counts.removals += n;
     }
     
-    /**
-     * Push: Add element to top of stack
-     * Time Complexity: O(1) amortized
-     */
-    void push(T value) {
-        if (topIndex == capacity - 1) {
-            resize();  // Expand if full
-        }
-        arr[++topIndex] = value;
-        cout << "Pushed: " << value << endl;
+    // Queue hooks: as above, plus the enqueue-to-dequeue timestamps
+    void onEnqueue(size_t n, size_t newSize) {
+        onInsert(n, newSize);
+        uint64_t now = readTimestamp();
+        for (size_t i = 0; i < n; i++) enqueueTimes.push_back(now);
     }
     
-    /**
-     * Pop: Remove and return top element
-     * Time Complexity: O(1)
-     */
-    T pop() {
-        if (isEmpty()) {
-            throw runtime_error("Stack Underflow: Cannot pop from empty stack");
+    void onDequeue(size_t n) {
+        onRemove(n);
+        uint64_t now = readTimestamp();
+        for (size_t i = 0; i < n && !enqueueTimes.empty(); i++) {
+            counts.latencyHistogram[bucketFor(now - enqueueTimes.front())]++;
+            counts.latencySamples++;
+            enqueueTimes.pop_front();
         }
-        T value = arr[topIndex--];
-        cout << "Popped: " << value << endl;
-        return value;
     }
     
-    /**
-     * Peek: View top element without removing
-     * Time Complexity: O(1)
-     */
-    T peek() const {
-        if (isEmpty()) {
-            throw runtime_error("Stack is empty: Cannot peek");
-        }
-        return arr[topIndex];
+    // Elements discarded without being dequeued (queue clear/restore)
+    void onClear() {
+        enqueueTimes.clear();
     }
     
-    /**
-     * Check if stack is empty
-     */
-    bool isEmpty() const {
-        return topIndex == -1;
+    void onResize(size_t bytesCopied) {
+        counts.resizes++;
+        counts.bytesCopied += bytesCopied;
     }
     
-    /**
-     * Get current size of stack
-     */
-    int size() const {
-        return topIndex + 1;
+    StatsSnapshot snapshot() const {
+        return counts;
     }
     
     /**
-     * Display all elements (top to bottom)
+     * Reset counters (e.g. after each scrape); queued timestamps are kept
      */
-    void display() const {
-        if (isEmpty()) {
-            cout << "Stack is empty" << endl;
-            return;
-        }
-        cout << "Stack (top to bottom): ";
-        for (int i = topIndex; i >= 0; i--) {
-            cout << arr[i];
-            if (i > 0) cout << " <- ";
-        }
-        cout << endl;
+    void reset() {
+        counts = StatsSnapshot();
     }
 };
 
+/**
+ * Policy used when a container does not name one explicitly
+ * Define STACK_QUEUE_STATS to count operations in every container.
+ */
+#ifdef STACK_QUEUE_STATS
+using DefaultStats = ContainerStats;
+#else
+using DefaultStats = NoStats;
+#endif
+
 // ============================================================================
-// QUEUE IMPLEMENTATION (FIFO - First In, First Out)
+// NON-THROWING RESULTS
 // ============================================================================
 
 /**
- * Node structure for linked-list based queue
+ * Reason a non-throwing operation produced no value
+ * Returned through std::expected where the standard library has it.
  */
-template <typename T>
-struct Node {
-    T data;
-    Node* next;
-    
-    Node(T value) : data(value), next(nullptr) {}
+enum class ContainerError {
+    Empty
 };
 
+// ============================================================================
+// BINARY SNAPSHOTS (serialize/deserialize support)
+// ============================================================================
+
 /**
- * Template-based Queue class using linked list
- * Avoids the circular array complexity
+ * Per-type binary encoding used by Stack and Queue snapshots
+ * Trivially copyable types are stored as their raw bytes (RAW = true),
+ * which lets a whole container be written or loaded with one call.
+ * Other types need a specialization providing write(out, value) and
+ * read(in); string is provided as a length-prefixed encoding.
  */
+template <typename T, typename Enable = void>
+struct BinaryCodec;
+
 template <typename T>
-class Queue {
-private:
-    Node<T>* frontPtr;   // Points to front of queue
-    Node<T>* rearPtr;    // Points to rear of queue
-    int count;           // Number of elements
+struct BinaryCodec<T, typename enable_if<is_trivially_copyable<T>::value>::type> {
+    static constexpr bool RAW = true;
     
-public:
-    /**
-     * Constructor: Initialize empty queue
-     */
-    Queue() {
-        frontPtr = nullptr;
-        rearPtr = nullptr;
-        count = 0;
-        cout << "Queue created" << endl;
+    static void write(ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
     }
     
-    /**
-     * Destructor: Free all nodes
-     */
-    ~Queue() {
-        while (!isEmpty()) {
-            dequeue();
-        }
-        cout << "Queue destroyed" << endl;
+    static T read(istream& in) {
+        T value;
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
     }
+};
+
+template <>
+struct BinaryCodec<string> {
+    static constexpr bool RAW = false;
     
-    /**
-     * Enqueue: Add element to rear of queue
-     * Time Complexity: O(1)
-     */
-    void enqueue(T value) {
-        Node<T>* newNode = new Node<T>(value);
-        
-        if (isEmpty()) {
-            // First element
-            frontPtr = rearPtr = newNode;
-        } else {
-            // Add to rear
-            rearPtr->next = newNode;
-            rearPtr = newNode;
-        }
-        count++;
-        cout << "Enqueued: " << value << endl;
+    static void write(ostream& out, const string& value) {
+        uint64_t length = value.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(value.data(), static_cast<streamsize>(length));
     }
     
-    /**
-     * Dequeue: Remove and return front element
-     * Time Complexity: O(1)
-     */
-    T dequeue() {
-        if (isEmpty()) {
-            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+    static string read(istream& in) {
+        uint64_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!in) throw runtime_error("Snapshot truncated: missing string length");
+        if (length > static_cast<uint64_t>(numeric_limits<streamsize>::max())) {
+            throw runtime_error("Snapshot invalid: string length out of range");
         }
-        
-        Node<T>* temp = frontPtr;
-        T value = temp->data;
-        frontPtr = frontPtr->next;
-        
-        // If queue becomes empty
-        if (frontPtr == nullptr) {
-            rearPtr = nullptr;
+        string value;
+        // Grow with the bytes actually read, so a corrupt length cannot
+        // demand a huge allocation up front
+        while (value.size() < length && in) {
+            size_t piece = static_cast<size_t>(length - value.size());
+            if (piece > 4096) piece = 4096;
+            size_t at = value.size();
+            value.resize(at + piece);
+            in.read(&value[at], static_cast<streamsize>(piece));
         }
-        
-        delete temp;
-        count--;
-        cout << "Dequeued: " << value << endl;
         return value;
     }
-    
-    /**
-     * Front: View front element without removing
-     * Time Complexity: O(1)
-     */
-    T front() const {
-        if (isEmpty()) {
-            throw runtime_error("Queue is empty: Cannot access front");
-        }
-        return frontPtr->data;
+};
+
+/**
+ * Snapshot layout (host byte order):
+ *   magic u32 | version u16 | kind u8 | encoding u8 | elementSize u32 | count u64
+ * followed by count elements, either as one raw image (encoding 0) or
+ * each through its BinaryCodec (encoding 1).
+ */
+enum class SnapshotKind : uint8_t {
+    Stack = 1,
+    Queue = 2
+};
+
+constexpr uint32_t SNAPSHOT_MAGIC = 0x31425153;  // "SQB1"
+constexpr uint16_t SNAPSHOT_VERSION = 1;
+
+/**
+ * Write the fixed snapshot header
+ */
+inline void writeSnapshotHeader(ostream& out, SnapshotKind kind, bool raw,
+                                uint32_t elementSize, uint64_t count) {
+    uint32_t magic = SNAPSHOT_MAGIC;
+    uint16_t version = SNAPSHOT_VERSION;
+    uint8_t kindByte = static_cast<uint8_t>(kind);
+    uint8_t encoding = raw ? 0 : 1;
+    out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char*>(&kindByte), sizeof(kindByte));
+    out.write(reinterpret_cast<const char*>(&encoding), sizeof(encoding));
+    out.write(reinterpret_cast<const char*>(&elementSize), sizeof(elementSize));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+}
+
+/**
+ * Read and validate the snapshot header; returns the element count
+ */
+inline uint64_t readSnapshotHeader(istream& in, SnapshotKind kind, bool raw,
+                                   uint32_t elementSize) {
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    uint8_t kindByte = 0;
+    uint8_t encoding = 0;
+    uint32_t storedSize = 0;
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&kindByte), sizeof(kindByte));
+    in.read(reinterpret_cast<char*>(&encoding), sizeof(encoding));
+    in.read(reinterpret_cast<char*>(&storedSize), sizeof(storedSize));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || magic != SNAPSHOT_MAGIC) {
+        throw runtime_error("Snapshot invalid: bad or missing header");
     }
-    
-    /**
-     * Check if queue is empty
-     */
-    bool isEmpty() const {
-        return frontPtr == nullptr;
+    if (version != SNAPSHOT_VERSION) {
+        throw runtime_error("Snapshot invalid: unsupported version " + to_string(version));
     }
-    
-    /**
-     * Get current size of queue
-     */
-    int size() const {
-        return count;
+    if (kindByte != static_cast<uint8_t>(kind)) {
+        throw runtime_error("Snapshot invalid: written by a different container kind");
     }
-    
-    /**
-     * Display all elements (front to rear)
-     */
-    void display() const {
-        if (isEmpty()) {
-            cout << "Queue is empty" << endl;
-            return;
-        }
-        cout << "Queue (front to rear): ";
-        Node<T>* current = frontPtr;
-        while (current != nullptr) {
-            cout << current->data;
-            if (current->next != nullptr) cout << " <- ";
-            current = current->next;
+    if (encoding != (raw ? 0 : 1) || storedSize != elementSize) {
+        throw runtime_error("Snapshot invalid: element type does not match");
+    }
+    return count;
+}
+
+/**
+ * Bytes between the read position and the end of the stream, or -1 when
+ * the stream cannot seek (pipes, sockets)
+ */
+inline streamoff snapshotBytesLeft(istream& in) {
+    streampos here = in.tellg();
+    if (here == streampos(-1)) {
+        in.clear();
+        return -1;
+    }
+    in.seekg(0, ios::end);
+    streampos end = in.tellg();
+    in.clear();
+    in.seekg(here);
+    if (end == streampos(-1) || !in) {
+        in.clear();
+        return -1;
+    }
+    return end - here;
+}
+
+constexpr size_t SNAPSHOT_CHUNK_BYTES = size_t(1) << 20;
+
+/**
+ * Validate a header's element count before anything is allocated for it
+ * Rejects counts above maxCount, and raw images (bytesPerElement > 0)
+ * longer than what is left in the stream. Returns how many elements may be
+ * allocated up front: all of them when the stream length vouches for the
+ * count, otherwise one SNAPSHOT_CHUNK_BYTES batch at a time.
+ */
+inline uint64_t checkSnapshotCount(istream& in, uint64_t count, uint64_t maxCount,
+                                   size_t bytesPerElement) {
+    if (count > maxCount) {
+        throw runtime_error("Snapshot invalid: count out of range");
+    }
+    if (bytesPerElement == 0) return 0;
+    streamoff left = snapshotBytesLeft(in);
+    if (left >= 0) {
+        if (count > static_cast<uint64_t>(left) / bytesPerElement) {
+            throw runtime_error("Snapshot invalid: count out of range");
         }
-        cout << endl;
+        return count;
     }
-};
+    uint64_t chunk = SNAPSHOT_CHUNK_BYTES / bytesPerElement;
+    return count < chunk ? count : (chunk > 0 ? chunk : 1);
+}
 
 // ============================================================================
-// DEMONSTRATION AND USE CASES
+// SEARCH AND REDUCTION KERNELS (SIMD for int32, scalar fallback)
 // ============================================================================
 
 /**
- * Demonstrate stack operations
+ * Instruction set the int32 kernels were compiled for
+ * Selected at compile time: build with -mavx2, -mavx512f or -march=native
+ * to get the vector paths on x86; AArch64 always has NEON.
  */
-void demonstrateStack() {
+#if defined(__AVX512F__)
+#define STACK_QUEUE_SIMD "AVX-512"
+#elif defined(__AVX2__)
+#define STACK_QUEUE_SIMD "AVX2"
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define STACK_QUEUE_SIMD "NEON"
+#else
+#define STACK_QUEUE_SIMD "scalar"
+#endif
+
+/**
+ * Type sum() returns: 64-bit for integers (so int32 sums cannot overflow),
+ * at least double for floating point, T itself for anything else
+ */
+template <typename T, typename Enable = void>
+struct SumResult {
+    using type = T;
+};
+
+template <typename T>
+struct SumResult<T, typename enable_if<is_integral<T>::value && is_signed<T>::value>::type> {
+    using type = int64_t;
+};
+
+template <typename T>
+struct SumResult<T, typename enable_if<is_integral<T>::value && !is_signed<T>::value>::type> {
+    using type = uint64_t;
+};
+
+template <typename T>
+struct SumResult<T, typename enable_if<is_floating_point<T>::value>::type> {
+    using type = typename common_type<T, double>::type;
+};
+
+template <typename T>
+using SumType = typename SumResult<T>::type;
+
+/**
+ * Returned by the span kernels when no element matches
+ */
+constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+// Hand-written vector kernels for 32-bit integers. Each one handles whole
+// vectors and returns how far it got; the scalar loops below finish the rest.
+#if defined(__AVX512F__)
+
+// The masked forms (all lanes enabled) are used for min/max/widen because
+// the unmasked wrappers in GCC 12's headers trip -Wmaybe-uninitialized.
+constexpr __mmask16 ALL_LANES_16 = 0xFFFF;
+constexpr __mmask8 ALL_LANES_8 = 0xFF;
+
+inline size_t simdFind(const int32_t* data, size_t n, int32_t value, size_t& done) {
+    __m512i needle = _mm512_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __mmask16 hits = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(data + i), needle);
+        if (hits != 0) return i + static_cast<size_t>(__builtin_ctz(hits));
+    }
+    done = i;
+    return NOT_FOUND;
+}
+
+inline size_t simdFindLast(const int32_t* data, size_t n, int32_t value, size_t& remaining) {
+    __m512i needle = _mm512_set1_epi32(value);
+    size_t i = n;
+    for (; i >= 16; i -= 16) {
+        __mmask16 hits = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(data + i - 16), needle);
+        if (hits != 0) return i - 16 + static_cast<size_t>(31 - __builtin_clz(hits));
+    }
+    remaining = i;
+    return NOT_FOUND;
+}
+
+inline size_t simdCount(const int32_t* data, size_t n, int32_t value, size_t& done) {
+    __m512i needle = _mm512_set1_epi32(value);
+    size_t total = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        total += static_cast<size_t>(__builtin_popcount(
+            _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(data + i), needle)));
+    }
+    done = i;
+    return total;
+}
+
+inline int32_t simdMin(const int32_t* data, size_t n, size_t& done) {
+    __m512i best = _mm512_set1_epi32(INT32_MAX);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        best = _mm512_mask_min_epi32(best, ALL_LANES_16, best, _mm512_loadu_si512(data + i));
+    }
+    done = i;
+    alignas(64) int32_t lanes[16];
+    _mm512_store_si512(lanes, best);
+    return *min_element(lanes, lanes + 16);
+}
+
+inline int32_t simdMax(const int32_t* data, size_t n, size_t& done) {
+    __m512i best = _mm512_set1_epi32(INT32_MIN);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        best = _mm512_mask_max_epi32(best, ALL_LANES_16, best, _mm512_loadu_si512(data + i));
+    }
+    done = i;
+    alignas(64) int32_t lanes[16];
+    _mm512_store_si512(lanes, best);
+    return *max_element(lanes, lanes + 16);
+}
+
+inline int64_t simdSum(const int32_t* data, size_t n, size_t& done) {
+    __m512i total = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        total = _mm512_add_epi64(total, _mm512_maskz_cvtepi32_epi64(ALL_LANES_8, lanes));
+    }
+    done = i;
+    alignas(64) int64_t parts[8];
+    _mm512_store_si512(parts, total);
+    int64_t sum = 0;
+    for (int64_t part : parts) sum += part;
+    return sum;
+}
+
+#elif defined(__AVX2__)
+
+inline int laneMask(__m256i matches) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(matches));
+}
+
+inline size_t simdFind(const int32_t* data, size_t n, int32_t value, size_t& done) {
+    __m256i needle = _mm256_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        int hits = laneMask(_mm256_cmpeq_epi32(lanes, needle));
+        if (hits != 0) return i + static_cast<size_t>(__builtin_ctz(hits));
+    }
+    done = i;
+    return NOT_FOUND;
+}
+
+inline size_t simdFindLast(const int32_t* data, size_t n, int32_t value, size_t& remaining) {
+    __m256i needle = _mm256_set1_epi32(value);
+    size_t i = n;
+    for (; i >= 8; i -= 8) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i - 8));
+        int hits = laneMask(_mm256_cmpeq_epi32(lanes, needle));
+        if (hits != 0) return i - 8 + static_cast<size_t>(31 - __builtin_clz(hits));
+    }
+    remaining = i;
+    return NOT_FOUND;
+}
+
+inline size_t simdCount(const int32_t* data, size_t n, int32_t value, size_t& done) {
+    __m256i needle = _mm256_set1_epi32(value);
+    size_t total = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        total += static_cast<size_t>(__builtin_popcount(laneMask(_mm256_cmpeq_epi32(lanes, needle))));
+    }
+    done = i;
+    return total;
+}
+
+inline int32_t simdMin(const int32_t* data, size_t n, size_t& done) {
+    __m256i best = _mm256_set1_epi32(INT32_MAX);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        best = _mm256_min_epi32(best, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    done = i;
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), best);
+    return *min_element(lanes, lanes + 8);
+}
+
+inline int32_t simdMax(const int32_t* data, size_t n, size_t& done) {
+    __m256i best = _mm256_set1_epi32(INT32_MIN);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        best = _mm256_max_epi32(best, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    done = i;
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), best);
+    return *max_element(lanes, lanes + 8);
+}
+
+inline int64_t simdSum(const int32_t* data, size_t n, size_t& done) {
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(lanes));
+    }
+    done = i;
+    alignas(32) int64_t parts[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(parts), total);
+    return parts[0] + parts[1] + parts[2] + parts[3];
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+inline size_t simdFind(const int32_t* data, size_t n, int32_t value, size_t& done) {
+    int32x4_t needle = vdupq_n_s32(value);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        if (vmaxvq_u32(vceqq_s32(vld1q_s32(data + i), needle)) != 0) {
+            while (data[i] != value) i++;
+            return i;
+        }
+    }
+    done = i;
+    return NOT_FOUND;
+}
+
+inline size_t simdFindLast(const int32_t* data, size_t n, int32_t value, size_t& remaining) {
+    int32x4_t needle = vdupq_n_s32(value);
+    size_t i = n;
+    for (; i >= 4; i -= 4) {
+        if (vmaxvq_u32(vceqq_s32(vld1q_s32(data + i - 4), needle)) != 0) {
+            i--;
+            while (data[i] != value) i--;
+            return i;
+        }
+    }
+    remaining = i;
+    return NOT_FOUND;
+}
+
+inline size_t simdCount(const int32_t* data, size_t n, int32_t value, size_t& done) {
+    int32x4_t needle = vdupq_n_s32(value);
+    uint32x4_t total = vdupq_n_u32(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        // A match is all ones, so subtracting it adds one to the lane
+        total = vsubq_u32(total, vceqq_s32(vld1q_s32(data + i), needle));
+    }
+    done = i;
+    return vaddvq_u32(total);
+}
+
+inline int32_t simdMin(const int32_t* data, size_t n, size_t& done) {
+    int32x4_t best = vdupq_n_s32(INT32_MAX);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) best = vminq_s32(best, vld1q_s32(data + i));
+    done = i;
+    return vminvq_s32(best);
+}
+
+inline int32_t simdMax(const int32_t* data, size_t n, size_t& done) {
+    int32x4_t best = vdupq_n_s32(INT32_MIN);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) best = vmaxq_s32(best, vld1q_s32(data + i));
+    done = i;
+    return vmaxvq_s32(best);
+}
+
+inline int64_t simdSum(const int32_t* data, size_t n, size_t& done) {
+    int64x2_t total = vdupq_n_s64(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) total = vpadalq_s32(total, vld1q_s32(data + i));
+    done = i;
+    return vaddvq_s64(total);
+}
+
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+#define STACK_QUEUE_HAVE_SIMD_KERNELS 1
+#else
+#define STACK_QUEUE_HAVE_SIMD_KERNELS 0
+#endif
+
+/**
+ * True when equality search over T can use the int32 kernels
+ * Only integers qualify: their == is bitwise, unlike float (-0.0, NaN).
+ */
+template <typename T>
+constexpr bool USE_SIMD_SEARCH = STACK_QUEUE_HAVE_SIMD_KERNELS && is_integral<T>::value &&
+                                 sizeof(T) == sizeof(int32_t) && !is_same<T, bool>::value;
+
+template <typename T>
+constexpr bool USE_SIMD_REDUCE = STACK_QUEUE_HAVE_SIMD_KERNELS && is_same<T, int32_t>::value;
+
+/**
+ * Span find: Index of the first element equal to value, or NOT_FOUND
+ */
+template <typename T>
+size_t spanFind(const T* data, size_t n, const T& value) {
+    size_t i = 0;
+#if STACK_QUEUE_HAVE_SIMD_KERNELS
+    if constexpr (USE_SIMD_SEARCH<T>) {
+        int32_t needle;
+        memcpy(&needle, &value, sizeof(needle));
+        size_t hit = simdFind(reinterpret_cast<const int32_t*>(data), n, needle, i);
+        if (hit != NOT_FOUND) return hit;
+    }
+#endif
+    for (; i < n; i++) {
+        if (data[i] == value) return i;
+    }
+    return NOT_FOUND;
+}
+
+/**
+ * Span find last: Index of the last element equal to value, or NOT_FOUND
+ */
+template <typename T>
+size_t spanFindLast(const T* data, size_t n, const T& value) {
+    size_t i = n;
+#if STACK_QUEUE_HAVE_SIMD_KERNELS
+    if constexpr (USE_SIMD_SEARCH<T>) {
+        int32_t needle;
+        memcpy(&needle, &value, sizeof(needle));
+        size_t hit = simdFindLast(reinterpret_cast<const int32_t*>(data), n, needle, i);
+        if (hit != NOT_FOUND) return hit;
+    }
+#endif
+    while (i > 0) {
+        i--;
+        if (data[i] == value) return i;
+    }
+    return NOT_FOUND;
+}
+
+/**
+ * Span count: Number of elements equal to value
+ */
+template <typename T>
+size_t spanCount(const T* data, size_t n, const T& value) {
+    size_t i = 0;
+    size_t total = 0;
+#if STACK_QUEUE_HAVE_SIMD_KERNELS
+    if constexpr (USE_SIMD_SEARCH<T>) {
+        int32_t needle;
+        memcpy(&needle, &value, sizeof(needle));
+        total = simdCount(reinterpret_cast<const int32_t*>(data), n, needle, i);
+    }
+#endif
+    for (; i < n; i++) {
+        total += data[i] == value;
+    }
+    return total;
+}
+
+/**
+ * Span min: Smallest element of a non-empty span
+ */
+template <typename T>
+T spanMin(const T* data, size_t n) {
+    assert(n > 0 && "spanMin on an empty span");
+    T best = data[0];
+    size_t i = 1;
+#if STACK_QUEUE_HAVE_SIMD_KERNELS
+    if constexpr (USE_SIMD_REDUCE<T>) {
+        best = simdMin(data, n, i);
+        if (i == 0) best = data[i++];
+    }
+#endif
+    for (; i < n; i++) {
+        if (data[i] < best) best = data[i];
+    }
+    return best;
+}
+
+/**
+ * Span max: Largest element of a non-empty span
+ */
+template <typename T>
+T spanMax(const T* data, size_t n) {
+    assert(n > 0 && "spanMax on an empty span");
+    T best = data[0];
+    size_t i = 1;
+#if STACK_QUEUE_HAVE_SIMD_KERNELS
+    if constexpr (USE_SIMD_REDUCE<T>) {
+        best = simdMax(data, n, i);
+        if (i == 0) best = data[i++];
+    }
+#endif
+    for (; i < n; i++) {
+        if (best < data[i]) best = data[i];
+    }
+    return best;
+}
+
+/**
+ * Span sum: Total of all elements, accumulated in SumType<T>
+ */
+template <typename T>
+SumType<T> spanSum(const T* data, size_t n) {
+    SumType<T> total{};
+    size_t i = 0;
+#if STACK_QUEUE_HAVE_SIMD_KERNELS
+    if constexpr (USE_SIMD_REDUCE<T>) {
+        total = simdSum(data, n, i);
+    }
+#endif
+    for (; i < n; i++) {
+        total = total + static_cast<SumType<T>>(data[i]);
+    }
+    return total;
+}
+
+/**
+ * Reductions over a container stored as several contiguous runs
+ * segments(visit) must call visit(const T* run, size_t length) for each
+ * run in order and stop as soon as visit returns false. RingQueue has two
+ * runs (either side of the wrap point), ChunkedQueue one per block; the
+ * linked Queue offers only runs of length one, so it never reaches the
+ * vector loops.
+ */
+template <typename T, typename Segments>
+size_t segmentsFind(Segments segments, const T& value) {
+    size_t offset = 0;
+    size_t found = NOT_FOUND;
+    segments([&](const T* run, size_t length) {
+        size_t hit = spanFind(run, length, value);
+        if (hit != NOT_FOUND) {
+            found = offset + hit;
+            return false;
+        }
+        offset += length;
+        return true;
+    });
+    return found;
+}
+
+template <typename T, typename Segments>
+size_t segmentsCount(Segments segments, const T& value) {
+    size_t total = 0;
+    segments([&](const T* run, size_t length) {
+        total += spanCount(run, length, value);
+        return true;
+    });
+    return total;
+}
+
+template <typename T, typename Segments>
+T segmentsMin(Segments segments) {
+    optional<T> best;
+    segments([&](const T* run, size_t length) {
+        T runBest = spanMin(run, length);
+        if (!best || runBest < *best) best = std::move(runBest);
+        return true;
+    });
+    return *best;
+}
+
+template <typename T, typename Segments>
+T segmentsMax(Segments segments) {
+    optional<T> best;
+    segments([&](const T* run, size_t length) {
+        T runBest = spanMax(run, length);
+        if (!best || *best < runBest) best = std::move(runBest);
+        return true;
+    });
+    return *best;
+}
+
+template <typename T, typename Segments>
+SumType<T> segmentsSum(Segments segments) {
+    SumType<T> total{};
+    segments([&](const T* run, size_t length) {
+        total = total + spanSum(run, length);
+        return true;
+    });
+    return total;
+}
+
+// ============================================================================
+// MEMORY PLACEMENT (cache-line padding, NUMA-node-local allocation)
+// ============================================================================
+
+/**
+ * Size assumed for a cache line when padding shared atomics apart
+ * 64 bytes covers current x86-64 and most ARM server cores.
+ */
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Value alone on its own cache line(s), for arrays of per-shard or
+ * per-thread state that different cores write
+ */
+template <typename T>
+struct alignas(CACHE_LINE_SIZE) CachePadded {
+    T value;
+};
+
+/**
+ * Number of NUMA nodes (1 when the platform does not report any)
+ */
+inline int numaNodeCount() {
+#if STACK_QUEUE_HAVE_NUMA
+    // "online" lists node ranges such as "0" or "0-1"; the last number wins
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if (f == nullptr) return 1;
+    int highest = 0;
+    int value = 0;
+    bool inNumber = false;
+    for (int c = fgetc(f); c != EOF; c = fgetc(f)) {
+        if (c >= '0' && c <= '9') {
+            value = (inNumber ? value * 10 : 0) + (c - '0');
+            inNumber = true;
+        } else {
+            if (inNumber && value > highest) highest = value;
+            inNumber = false;
+        }
+    }
+    if (inNumber && value > highest) highest = value;
+    fclose(f);
+    return highest + 1;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * NUMA node of the CPU the caller is running on right now (0 if unknown)
+ */
+inline int currentNumaNode() {
+#if STACK_QUEUE_HAVE_NUMA
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+    return static_cast<int>(node);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * currentNumaNode() cached per thread and refreshed every 256 calls,
+ * so hot paths do not pay a system call per operation
+ */
+inline int cachedNumaNode() {
+    thread_local int node = -1;
+    thread_local unsigned calls = 0;
+    if (node < 0 || (++calls & 255) == 0) {
+        node = currentNumaNode();
+    }
+    return node;
+}
+
+/**
+ * Allocate bytes preferring the memory of NUMA node (node < 0: no
+ * preference, plain cache-line-aligned heap memory)
+ * Node-local memory is mapped with mmap and tagged with mbind before
+ * the first touch, using the raw system call so no libnuma is needed.
+ * MPOL_PREFERRED falls back to other nodes instead of failing, and if
+ * mbind itself is unavailable the memory is still usable, just unplaced.
+ */
+inline void* numaAllocate(size_t bytes, int node) {
+#if STACK_QUEUE_HAVE_NUMA
+    if (node >= 0) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw bad_alloc();
+        if (node < 64) {
+            constexpr int MPOL_PREFERRED_MODE = 1;
+            unsigned long nodeMask = 1UL << node;
+            syscall(SYS_mbind, p, bytes, MPOL_PREFERRED_MODE, &nodeMask,
+                    sizeof(nodeMask) * 8, 0);
+        }
+        return p;
+    }
+#endif
+    (void)node;
+    return ::operator new(bytes, align_val_t(CACHE_LINE_SIZE));
+}
+
+/**
+ * Release memory from numaAllocate (same bytes and node)
+ */
+inline void numaFree(void* p, size_t bytes, int node) {
+    if (p == nullptr) return;
+#if STACK_QUEUE_HAVE_NUMA
+    if (node >= 0) {
+        munmap(p, bytes);
+        return;
+    }
+#endif
+    (void)bytes;
+    (void)node;
+    ::operator delete(p, align_val_t(CACHE_LINE_SIZE));
+}
+
+// ============================================================================
+// STACK IMPLEMENTATION (LIFO - Last In, First Out)
+// ============================================================================
+
+/**
+ * Uninitialized in-object storage for N elements (nothing when N == 0)
+ */
+template <typename T, size_t N>
+struct InlineBuffer {
+    alignas(T) unsigned char bytes[N * sizeof(T)];
+    
+    T* data() {
+        return reinterpret_cast<T*>(bytes);
+    }
+};
+
+template <typename T>
+struct InlineBuffer<T, 0> {
+    T* data() {
+        return nullptr;
+    }
+};
+
+/**
+ * Growth policies for Stack
+ * grow(capacity, minCapacity) returns the next capacity (>= minCapacity).
+ * AUTO_SHRINK policies also provide shrinkTarget(size, capacity), which
+ * returns a smaller capacity when the stack should give memory back.
+ */
+
+/**
+ * Double on every growth (the original behaviour)
+ */
+struct DoublingGrowth {
+    static constexpr bool AUTO_SHRINK = false;
+    
+    static int grow(int capacity, int minCapacity) {
+        int next = capacity > 0 ? capacity * 2 : 1;
+        return next < minCapacity ? minCapacity : next;
+    }
+};
+
+/**
+ * Grow by half again (1.5x): less slack memory than doubling
+ */
+struct HalfAgainGrowth {
+    static constexpr bool AUTO_SHRINK = false;
+    
+    static int grow(int capacity, int minCapacity) {
+        int next = capacity + capacity / 2 + 1;
+        return next < minCapacity ? minCapacity : next;
+    }
+};
+
+/**
+ * Grow by a fixed number of elements: predictable, O(n) amortized push
+ */
+template <int Increment>
+struct FixedIncrementGrowth {
+    static_assert(Increment > 0, "FixedIncrementGrowth needs a positive increment");
+    static constexpr bool AUTO_SHRINK = false;
+    
+    static int grow(int capacity, int minCapacity) {
+        int next = capacity + Increment;
+        return next < minCapacity ? minCapacity : next;
+    }
+};
+
+/**
+ * Wrap another policy with automatic shrinking
+ * Halves the capacity once the size falls to 1/ShrinkDivisor of it. The
+ * gap between that threshold and the halved capacity (hysteresis) means a
+ * stack oscillating around one size does not grow and shrink each time.
+ */
+template <typename BaseGrowth = DoublingGrowth, int ShrinkDivisor = 4, int MinCapacity = 16>
+struct HysteresisShrink {
+    static_assert(ShrinkDivisor > 2, "ShrinkDivisor must exceed 2 to leave hysteresis");
+    static constexpr bool AUTO_SHRINK = true;
+    
+    static int grow(int capacity, int minCapacity) {
+        return BaseGrowth::grow(capacity, minCapacity);
+    }
+    
+    static int shrinkTarget(int size, int capacity) {
+        if (capacity <= MinCapacity || size > capacity / ShrinkDivisor) {
+            return capacity;
+        }
+        int target = capacity / 2;
+        return target < MinCapacity ? MinCapacity : target;
+    }
+};
+
+/**
+ * Template-based Stack class using dynamic arrays
+ * Supports any data type (int, string, custom objects, etc.)
+ * Trace selects the logging policy (NoTrace, ConsoleTrace, or custom)
+ * InlineCapacity elements live inside the object itself; the heap is only
+ * used once the stack outgrows them (see SmallStack below)
+ * Alloc is a std::allocator-compatible allocator for the heap storage
+ * Growth picks the growth (and optional shrink) policy
+ * Stats selects operation counting (NoStats, ContainerStats, or custom)
+ * Storage is left uninitialized; slots above topIndex hold no live object.
+ */
+template <typename T, typename Trace = DefaultTrace, size_t InlineCapacity = 0,
+          typename Alloc = allocator<T>, typename Growth = DoublingGrowth,
+          typename Stats = DefaultStats>
+class Stack {
+private:
+    using AllocTraits = allocator_traits<Alloc>;
+    static_assert(is_same<typename AllocTraits::value_type, T>::value,
+                  "Stack allocator must allocate T");
+    
+    // Trivially copyable T can be relocated bytewise, so with the default
+    // allocator the heap buffer is managed with malloc/realloc. realloc can
+    // often extend in place, and glibc serves large blocks with mmap and
+    // grows them with mremap, so no element copy happens at all.
+    static constexpr bool USE_REALLOC = is_same<Alloc, allocator<T>>::value &&
+                                        is_trivially_copyable<T>::value &&
+                                        alignof(T) <= alignof(max_align_t);
+    
+    T* arr;              // Uninitialized storage for capacity elements
+    int topIndex;        // Index of top element (-1 if empty)
+    int capacity;        // Maximum capacity of stack
+    Alloc alloc;
+    InlineBuffer<T, InlineCapacity> inlineStorage;
+    [[no_unique_address]] Stats counters;
+    
+    /**
+     * Check whether arr points at the in-object buffer
+     */
+    bool usingInline() const {
+        return InlineCapacity > 0 &&
+               arr == const_cast<InlineBuffer<T, InlineCapacity>&>(inlineStorage).data();
+    }
+    
+    /**
+     * Allocate heap storage for n elements
+     */
+    T* allocateStorage(int n) {
+        if constexpr (USE_REALLOC) {
+            void* p = malloc(static_cast<size_t>(n > 0 ? n : 1) * sizeof(T));
+            if (p == nullptr) throw bad_alloc();
+            return static_cast<T*>(p);
+        } else {
+            return AllocTraits::allocate(alloc, n);
+        }
+    }
+    
+    /**
+     * Free heap storage obtained from allocateStorage(n)
+     */
+    void freeStorage(T* p, int n) {
+        if constexpr (USE_REALLOC) {
+            free(p);
+        } else {
+            AllocTraits::deallocate(alloc, p, n);
+        }
+    }
+    
+    /**
+     * Release arr if it came from the heap
+     */
+    void releaseStorage() {
+        if (!usingInline()) {
+            freeStorage(arr, capacity);
+        }
+    }
+    
+    /**
+     * Move the elements into storage for exactly newCapacity elements
+     * (newCapacity >= size()); returns to the inline buffer when they fit
+     */
+    void reallocate(int newCapacity) {
+        bool toInline = InlineCapacity > 0 && newCapacity <= static_cast<int>(InlineCapacity);
+        if (toInline && usingInline()) return;
+        
+        if constexpr (USE_REALLOC) {
+            if (!usingInline() && !toInline) {
+                size_t bytes = static_cast<size_t>(newCapacity > 0 ? newCapacity : 1) * sizeof(T);
+                void* p = realloc(arr, bytes);
+                if (p == nullptr) throw bad_alloc();
+                arr = static_cast<T*>(p);
+                capacity = newCapacity;
+                counters.onResize(static_cast<size_t>(size()) * sizeof(T));
+                Trace::log("Stack resized to capacity: ", capacity);
+                return;
+            }
+        }
+        
+        T* newArr = toInline ? inlineStorage.data() : allocateStorage(newCapacity);
+        
+        // Relocate existing elements into the new array (copy instead of
+        // move if the move constructor may throw). The old elements are
+        // only destroyed once every copy succeeded, so a throw leaves the
+        // stack exactly as it was.
+        int built = 0;
+        try {
+            for (; built <= topIndex; built++) {
+                AllocTraits::construct(alloc, &newArr[built], move_if_noexcept(arr[built]));
+            }
+        } catch (...) {
+            for (int i = 0; i < built; i++) {
+                AllocTraits::destroy(alloc, &newArr[i]);
+            }
+            if (!toInline) freeStorage(newArr, newCapacity);
+            throw;
+        }
+        for (int i = 0; i <= topIndex; i++) {
+            AllocTraits::destroy(alloc, &arr[i]);
+        }
+        
+        releaseStorage();  // Free old memory
+        arr = newArr;
+        capacity = toInline ? static_cast<int>(InlineCapacity) : newCapacity;
+        counters.onResize(static_cast<size_t>(size()) * sizeof(T));
+        Trace::log("Stack resized to capacity: ", capacity);
+    }
+    
+    /**
+     * Resize the stack when capacity is reached
+     * Asks the growth policy for a capacity of at least minCapacity
+     */
+    void resize(int minCapacity = 0) {
+        reallocate(Growth::grow(capacity, minCapacity));
+    }
+    
+    /**
+     * Give memory back after pops when the growth policy asks for it
+     * Shrinking is only an optimization, so allocation failure is ignored
+     */
+    void maybeShrink() {
+        if constexpr (Growth::AUTO_SHRINK) {
+            int target = Growth::shrinkTarget(size(), capacity);
+            if (target < capacity && !usingInline()) {
+                try {
+                    reallocate(target);
+                } catch (const bad_alloc&) {
+                }
+            }
+        }
+    }
+    
+public:
+    /**
+     * Constructor: Initialize empty stack with given capacity
+     * No heap allocation happens while size fits the inline buffer
+     */
+    Stack(int size = 10, const Alloc& allocator = Alloc()) : alloc(allocator) {
+        if (InlineCapacity > 0 && size <= static_cast<int>(InlineCapacity)) {
+            arr = inlineStorage.data();
+            capacity = static_cast<int>(InlineCapacity);
+        } else {
+            arr = allocateStorage(size);
+            capacity = size;
+        }
+        topIndex = -1;  // Empty stack
+        Trace::log("Stack created with capacity: ", capacity);
+    }
+    
+    // arr may point into this object, so a memberwise copy is never valid
+    Stack(const Stack&) = delete;
+    Stack& operator=(const Stack&) = delete;
+    
+    /**
+     * Destructor: Destroy live elements and free dynamic memory
+     */
+    ~Stack() {
+        while (topIndex >= 0) {
+            AllocTraits::destroy(alloc, &arr[topIndex--]);
+        }
+        releaseStorage();
+        Trace::log("Stack destroyed");
+    }
+    
+    /**
+     * Push: Add element to top of stack
+     * Time Complexity: O(1) amortized
+     */
+    void push(const T& value) {
+        emplace(value);
+    }
+    
+    void push(T&& value) {
+        emplace(std::move(value));
+    }
+    
+    /**
+     * Emplace: Construct element in place on top of stack
+     * Time Complexity: O(1) amortized
+     */
+    template <typename... Args>
+    T& emplace(Args&&... args) {
+        if (topIndex == capacity - 1) {
+            // Arguments may refer to an element that resize() relocates,
+            // so construct the value first (one extra move, growth only)
+            T value(std::forward<Args>(args)...);
+            resize();  // Expand if full
+            return emplace(std::move(value));
+        }
+        T* slot = &arr[topIndex + 1];
+        AllocTraits::construct(alloc, slot, std::forward<Args>(args)...);
+        topIndex++;
+        counters.onInsert(1, static_cast<size_t>(size()));
+        Trace::log("Pushed: ", *slot);
+        return *slot;
+    }
+    
+    /**
+     * Pop: Remove and return top element
+     * The element is moved out and its slot destroyed
+     * Time Complexity: O(1)
+     */
+    T pop() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Stack Underflow: Cannot pop from empty stack");
+        }
+        return pop_unchecked();
+    }
+    
+    /**
+     * Pop into: Move top element into out, reusing out's resources
+     * Time Complexity: O(1)
+     */
+    void pop(T& out) {
+        if (!try_pop(out)) [[unlikely]] {
+            throw runtime_error("Stack Underflow: Cannot pop from empty stack");
+        }
+    }
+    
+    /**
+     * Try pop: Move top element into out; returns false if empty
+     * Never throws on an empty stack, for polling loops
+     */
+    bool try_pop(T& out) {
+        if (isEmpty()) [[unlikely]] {
+            return false;
+        }
+        out = std::move(arr[topIndex]);
+        AllocTraits::destroy(alloc, &arr[topIndex--]);
+        counters.onRemove(1);
+        Trace::log("Popped: ", out);
+        maybeShrink();
+        return true;
+    }
+    
+    /**
+     * Pop optional: Top element, or nullopt if empty
+     */
+    optional<T> pop_optional() {
+        if (isEmpty()) [[unlikely]] {
+            return nullopt;
+        }
+        return pop_unchecked();
+    }
+    
+#ifdef __cpp_lib_expected
+    /**
+     * Pop expected: Top element, or ContainerError::Empty
+     */
+    expected<T, ContainerError> pop_expected() {
+        if (isEmpty()) [[unlikely]] {
+            return unexpected(ContainerError::Empty);
+        }
+        return pop_unchecked();
+    }
+#endif
+    
+    /**
+     * Pop unchecked: Remove and return top element without an empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    T pop_unchecked() {
+        assert(!isEmpty());
+        T value = std::move(arr[topIndex]);
+        AllocTraits::destroy(alloc, &arr[topIndex--]);
+        counters.onRemove(1);
+        Trace::log("Popped: ", value);
+        maybeShrink();
+        return value;
+    }
+    
+    /**
+     * Peek: View top element without removing
+     * Time Complexity: O(1)
+     */
+    T peek() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Stack is empty: Cannot peek");
+        }
+        return arr[topIndex];
+    }
+    
+    /**
+     * Try peek: Pointer to top element, or nullptr if empty
+     */
+    const T* try_peek() const {
+        if (isEmpty()) [[unlikely]] {
+            return nullptr;
+        }
+        return &arr[topIndex];
+    }
+    
+    /**
+     * Top: Reference to top element without an empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    const T& top() const {
+        assert(!isEmpty());
+        return arr[topIndex];
+    }
+    
+    /**
+     * Check if stack is empty
+     */
+    bool isEmpty() const {
+        return topIndex == -1;
+    }
+    
+    /**
+     * Get current size of stack
+     */
+    int size() const {
+        return topIndex + 1;
+    }
+    
+    /**
+     * Push range: Push every element of [first, last) in order
+     * Capacity is reserved once for forward iterators; contiguous ranges of
+     * trivially copyable T are copied with a single memcpy
+     * Time Complexity: O(n)
+     */
+    template <typename InputIt>
+    void push_range(InputIt first, InputIt last) {
+        using Category = typename iterator_traits<InputIt>::iterator_category;
+        if constexpr (!is_base_of<forward_iterator_tag, Category>::value) {
+            for (; first != last; ++first) push(*first);
+        } else {
+            int n = static_cast<int>(distance(first, last));
+            if (n == 0) return;
+            if (topIndex + n >= capacity) {
+                resize(topIndex + 1 + n);
+            }
+            T* dest = &arr[topIndex + 1];
+            if constexpr (contiguous_iterator<InputIt> && is_trivially_copyable<T>::value &&
+                          is_same<typename remove_cv<iter_value_t<InputIt>>::type, T>::value) {
+                memcpy(static_cast<void*>(dest), to_address(first), n * sizeof(T));
+            } else {
+                // topIndex only covers the batch once it is complete, so a
+                // throwing constructor must tear down what it already built
+                int i = 0;
+                try {
+                    for (; i < n; i++, ++first) {
+                        AllocTraits::construct(alloc, &dest[i], *first);
+                    }
+                } catch (...) {
+                    while (i > 0) AllocTraits::destroy(alloc, &dest[--i]);
+                    throw;
+                }
+            }
+            topIndex += n;
+            counters.onInsert(static_cast<size_t>(n), static_cast<size_t>(size()));
+            Trace::log("Pushed ", n, " elements");
+        }
+    }
+    
+    /**
+     * Pop n: Pop up to n elements into out, top first
+     * Returns the number of elements popped (fewer if the stack runs out)
+     * Time Complexity: O(n)
+     */
+    template <typename OutputIt>
+    int pop_n(OutputIt out, int n) {
+        int popped = n < size() ? n : size();
+        for (int i = 0; i < popped; i++, ++out) {
+            *out = std::move(arr[topIndex]);
+            AllocTraits::destroy(alloc, &arr[topIndex--]);
+        }
+        counters.onRemove(static_cast<size_t>(popped));
+        Trace::log("Popped ", popped, " elements");
+        maybeShrink();
+        return popped;
+    }
+    
+    /**
+     * Clear: Destroy every element (capacity is kept)
+     */
+    void clear() {
+        while (topIndex >= 0) {
+            AllocTraits::destroy(alloc, &arr[topIndex--]);
+        }
+    }
+    
+    /**
+     * Serialize: Write a binary snapshot, bottom to top
+     * Trivially copyable T is written as one contiguous image
+     */
+    void serialize(ostream& out) const {
+        using Codec = BinaryCodec<T>;
+        writeSnapshotHeader(out, SnapshotKind::Stack, Codec::RAW,
+                            Codec::RAW ? sizeof(T) : 0, static_cast<uint64_t>(size()));
+        if constexpr (Codec::RAW) {
+            out.write(reinterpret_cast<const char*>(arr), static_cast<streamsize>(size()) * sizeof(T));
+        } else {
+            for (int i = 0; i <= topIndex; i++) {
+                Codec::write(out, arr[i]);
+            }
+        }
+        if (!out) throw runtime_error("Snapshot write failed");
+    }
+    
+    /**
+     * Deserialize: Replace the contents with a snapshot from serialize()
+     * Trivially copyable T is loaded with a single read into the buffer
+     */
+    void deserialize(istream& in) {
+        using Codec = BinaryCodec<T>;
+        uint64_t count = readSnapshotHeader(in, SnapshotKind::Stack, Codec::RAW,
+                                            Codec::RAW ? sizeof(T) : 0);
+        uint64_t upfront = checkSnapshotCount(in, count, numeric_limits<int>::max(),
+                                              Codec::RAW ? sizeof(T) : 0);
+        clear();
+        if constexpr (Codec::RAW) {
+            // A seekable stream vouches for the whole count, so this is one
+            // reserve and one read; otherwise memory follows the bytes read
+            reserve(static_cast<int>(upfront));
+            while (static_cast<uint64_t>(size()) < count) {
+                uint64_t remaining = count - static_cast<uint64_t>(size());
+                int batch = static_cast<int>(remaining < upfront ? remaining : upfront);
+                if (size() + batch > capacity) resize(size() + batch);
+                streamsize bytes = static_cast<streamsize>(batch) * sizeof(T);
+                in.read(reinterpret_cast<char*>(arr + size()), bytes);
+                if (in.gcount() != bytes) throw runtime_error("Snapshot truncated: missing elements");
+                topIndex += batch;
+            }
+            counters.onInsert(static_cast<size_t>(count), static_cast<size_t>(count));
+        } else {
+            for (uint64_t i = 0; i < count; i++) {
+                T value = Codec::read(in);
+                if (!in) throw runtime_error("Snapshot truncated: missing elements");
+                push(std::move(value));
+            }
+        }
+        Trace::log("Stack restored with ", count, " elements");
+    }
+    
+    /**
+     * Reserve: Ensure room for at least n elements without regrowing
+     */
+    void reserve(int n) {
+        if (n > capacity) {
+            reallocate(n);
+        }
+    }
+    
+    /**
+     * Shrink to fit: Release unused capacity (back to the inline buffer
+     * when the elements fit there)
+     */
+    void shrink_to_fit() {
+        int target = size() > 0 ? size() : 1;
+        if (target < capacity) {
+            reallocate(target);
+        }
+    }
+    
+    /**
+     * Get current capacity of stack
+     */
+    int getCapacity() const {
+        return capacity;
+    }
+    
+    /**
+     * Stats: Snapshot of the counters (all zero under NoStats)
+     */
+    StatsSnapshot stats() const {
+        return counters.snapshot();
+    }
+    
+    void resetStats() {
+        counters.reset();
+    }
+    
+    /**
+     * Contains: Check whether any element equals value
+     * Time Complexity: O(n), vectorized for 32-bit integers
+     */
+    bool contains(const T& value) const {
+        return find(value) != -1;
+    }
+    
+    /**
+     * Find: Distance from the top of the nearest element equal to value
+     * (0 means it is the next one popped); returns -1 if absent
+     */
+    int find(const T& value) const {
+        size_t hit = spanFindLast(arr, static_cast<size_t>(topIndex + 1), value);
+        return hit == NOT_FOUND ? -1 : topIndex - static_cast<int>(hit);
+    }
+    
+    /**
+     * Count: Number of elements equal to value
+     */
+    int count(const T& value) const {
+        return static_cast<int>(spanCount(arr, static_cast<size_t>(topIndex + 1), value));
+    }
+    
+    /**
+     * Min / max: Smallest or largest element; throws if empty
+     */
+    T min() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Stack is empty: Cannot compute min");
+        }
+        return spanMin(arr, static_cast<size_t>(topIndex + 1));
+    }
+    
+    T max() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Stack is empty: Cannot compute max");
+        }
+        return spanMax(arr, static_cast<size_t>(topIndex + 1));
+    }
+    
+    /**
+     * Sum: Total of all elements (64-bit accumulator for integers)
+     */
+    SumType<T> sum() const {
+        return spanSum(arr, static_cast<size_t>(topIndex + 1));
+    }
+    
+    
+    /**
+     * Display all elements (top to bottom)
+     */
+    void display() const {
+        if (isEmpty()) {
+            cout << "Stack is empty" << endl;
+            return;
+        }
+        cout << "Stack (top to bottom): ";
+        for (int i = topIndex; i >= 0; i--) {
+            cout << arr[i];
+            if (i > 0) cout << " <- ";
+        }
+        cout << endl;
+    }
+};
+
+/**
+ * Stack whose first N elements live inside the object
+ * Suited to short-lived stacks (expression evaluation, backtracking) that
+ * rarely exceed N: they never touch the heap.
+ */
+template <typename T, size_t N, typename Trace = DefaultTrace, typename Alloc = allocator<T>,
+          typename Growth = DoublingGrowth, typename Stats = DefaultStats>
+using SmallStack = Stack<T, Trace, N, Alloc, Growth, Stats>;
+
+// ============================================================================
+// QUEUE IMPLEMENTATION (FIFO - First In, First Out)
+// ============================================================================
+
+/**
+ * Node structure for linked-list based queue
+ */
+template <typename T>
+struct Node {
+    T data;
+    Node* next;
+    
+    /**
+     * Construct data in place from args (in_place keeps this from
+     * competing with the copy constructor)
+     */
+    template <typename... Args>
+    Node(in_place_t, Args&&... args) : data(std::forward<Args>(args)...), next(nullptr) {}
+};
+
+/**
+ * Free-list pool that hands out raw storage for one NodeT at a time
+ * Storage is carved sequentially out of chunks of about 4 KB, so nodes
+ * allocated together sit next to each other in memory. Released nodes go
+ * on a free list and are reused before any new chunk is requested.
+ * Chunks are returned to the system only when the pool is destroyed.
+ * A pool built with a NUMA node takes its chunks from that node's memory.
+ * Not thread-safe.
+ */
+template <typename NodeT>
+class NodePool {
+private:
+    union Slot {
+        Slot* next;                                     // While on free list
+        alignas(NodeT) unsigned char storage[sizeof(NodeT)];
+    };
+    
+    static constexpr size_t CHUNK_BYTES = 4096;
+    
+    vector<Slot*> chunks;    // Every chunk ever allocated
+    Slot* freeList;          // Released slots, most recent first
+    Slot* bump;              // Next never-used slot in the newest chunk
+    Slot* bumpEnd;           // One past the newest chunk
+    int numaNode;            // Node chunks are placed on (-1: any)
+    
+public:
+    static constexpr size_t NODES_PER_CHUNK =
+        sizeof(Slot) >= CHUNK_BYTES ? 1 : CHUNK_BYTES / sizeof(Slot);
+    
+    explicit NodePool(int node = -1)
+        : freeList(nullptr), bump(nullptr), bumpEnd(nullptr), numaNode(node) {}
+    
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    
+    NodePool(NodePool&& other) noexcept
+        : chunks(std::move(other.chunks)), freeList(other.freeList),
+          bump(other.bump), bumpEnd(other.bumpEnd), numaNode(other.numaNode) {
+        other.chunks.clear();
+        other.freeList = other.bump = other.bumpEnd = nullptr;
+    }
+    
+    NodePool& operator=(NodePool&&) = delete;
+    
+    ~NodePool() {
+        for (Slot* chunk : chunks) {
+            numaFree(chunk, NODES_PER_CHUNK * sizeof(Slot), numaNode);
+        }
+    }
+    
+    /**
+     * Allocate: Storage for one node (not constructed)
+     * Time Complexity: O(1) amortized
+     */
+    void* allocate() {
+        if (freeList != nullptr) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            return slot->storage;
+        }
+        if (bump == bumpEnd) {
+            Slot* chunk = static_cast<Slot*>(numaAllocate(NODES_PER_CHUNK * sizeof(Slot), numaNode));
+            chunks.push_back(chunk);
+            bump = chunk;
+            bumpEnd = chunk + NODES_PER_CHUNK;
+        }
+        return (bump++)->storage;
+    }
+    
+    /**
+     * Deallocate: Return storage of an already destroyed node
+     * Time Complexity: O(1)
+     */
+    void deallocate(void* p) {
+        Slot* slot = static_cast<Slot*>(p);
+        slot->next = freeList;
+        freeList = slot;
+    }
+    
+    /**
+     * Number of chunks obtained from the system so far
+     */
+    size_t chunkCount() const {
+        return chunks.size();
+    }
+};
+
+/**
+ * Node allocator policies for Queue
+ * Each provides allocate() returning raw storage for one NodeT and
+ * deallocate(p) taking it back; Queue constructs and destroys the nodes.
+ */
+
+/**
+ * Plain operator new/delete per node (the original behaviour)
+ */
+template <typename NodeT>
+struct HeapNodeAllocator {
+    void* allocate() {
+        return ::operator new(sizeof(NodeT));
+    }
+    
+    void deallocate(void* p) {
+        ::operator delete(p);
+    }
+};
+
+/**
+ * Private pool owned by each queue; freed together with the queue
+ */
+template <typename NodeT>
+class PooledNodeAllocator {
+private:
+    NodePool<NodeT> pool;
+    
+public:
+    void* allocate() {
+        return pool.allocate();
+    }
+    
+    void deallocate(void* p) {
+        pool.deallocate(p);
+    }
+};
+
+/**
+ * One pool per thread, shared by every queue of that node type on it
+ * A queue must be used and destroyed on the thread that created it, since
+ * the pool (and its chunks) go away when that thread exits.
+ */
+template <typename NodeT>
+class ThreadLocalNodeAllocator {
+private:
+    static NodePool<NodeT>& pool() {
+        thread_local NodePool<NodeT> threadPool;
+        return threadPool;
+    }
+    
+public:
+    void* allocate() {
+        return pool().allocate();
+    }
+    
+    void deallocate(void* p) {
+        pool().deallocate(p);
+    }
+};
+
+/**
+ * Caller-supplied arena, possibly shared by several queues
+ * The arena must outlive every queue that uses it.
+ */
+template <typename NodeT>
+class ArenaNodeAllocator {
+private:
+    NodePool<NodeT>* arena;
+    
+public:
+    explicit ArenaNodeAllocator(NodePool<NodeT>& nodeArena) : arena(&nodeArena) {}
+    
+    void* allocate() {
+        return arena->allocate();
+    }
+    
+    void deallocate(void* p) {
+        arena->deallocate(p);
+    }
+};
+
+/**
+ * Template-based Queue class using linked list
+ * Avoids the circular array complexity
+ * Opt-in choice when element addresses must stay stable; see RingQueue
+ * Trace selects the logging policy (NoTrace, ConsoleTrace, or custom)
+ * NodeAllocator supplies node storage (HeapNodeAllocator, PooledNodeAllocator,
+ * ThreadLocalNodeAllocator, or ArenaNodeAllocator)
+ * Stats selects operation counting (NoStats, ContainerStats, or custom)
+ */
+template <typename T, typename Trace = DefaultTrace,
+          template <typename> class NodeAllocator = HeapNodeAllocator,
+          typename Stats = DefaultStats>
+class Queue {
+private:
+    Node<T>* frontPtr;   // Points to front of queue
+    Node<T>* rearPtr;    // Points to rear of queue
+    int elementCount;    // Number of elements
+    NodeAllocator<Node<T>> nodeAlloc;
+    [[no_unique_address]] Stats counters;
+    
+    /**
+     * Allocate and construct one unlinked node; the storage goes back to
+     * the allocator if constructing the element throws
+     */
+    template <typename... Args>
+    Node<T>* makeNode(Args&&... args) {
+        void* raw = nodeAlloc.allocate();
+        try {
+            return new (raw) Node<T>(in_place, std::forward<Args>(args)...);
+        } catch (...) {
+            nodeAlloc.deallocate(raw);
+            throw;
+        }
+    }
+    
+public:
+    /**
+     * Constructor: Initialize empty queue
+     */
+    Queue() {
+        frontPtr = nullptr;
+        rearPtr = nullptr;
+        elementCount = 0;
+        Trace::log("Queue created");
+    }
+    
+    /**
+     * Constructor: Initialize empty queue with a configured node allocator
+     * (required for ArenaNodeAllocator)
+     */
+    explicit Queue(NodeAllocator<Node<T>> allocator) : nodeAlloc(std::move(allocator)) {
+        frontPtr = nullptr;
+        rearPtr = nullptr;
+        elementCount = 0;
+        Trace::log("Queue created");
+    }
+    
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+    
+    /**
+     * Destructor: Free all nodes
+     */
+    ~Queue() {
+        while (!isEmpty()) {
+            dequeue();
+        }
+        Trace::log("Queue destroyed");
+    }
+    
+    /**
+     * Enqueue: Add element to rear of queue
+     * Time Complexity: O(1)
+     */
+    void enqueue(T value) {
+        Node<T>* newNode = makeNode(std::move(value));
+        
+        if (isEmpty()) {
+            // First element
+            frontPtr = rearPtr = newNode;
+        } else {
+            // Add to rear
+            rearPtr->next = newNode;
+            rearPtr = newNode;
+        }
+        elementCount++;
+        counters.onEnqueue(1, static_cast<size_t>(elementCount));
+        Trace::log("Enqueued: ", newNode->data);
+    }
+    
+    /**
+     * Dequeue: Remove and return front element
+     * Time Complexity: O(1)
+     */
+    T dequeue() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+        }
+        return dequeue_unchecked();
+    }
+    
+    /**
+     * Try dequeue: Move front element into out; returns false if empty
+     * Never throws on an empty queue, for polling loops
+     */
+    bool try_dequeue(T& out) {
+        if (isEmpty()) [[unlikely]] {
+            return false;
+        }
+        out = dequeue_unchecked();
+        return true;
+    }
+    
+    /**
+     * Dequeue optional: Front element, or nullopt if empty
+     */
+    optional<T> dequeue_optional() {
+        if (isEmpty()) [[unlikely]] {
+            return nullopt;
+        }
+        return dequeue_unchecked();
+    }
+    
+#ifdef __cpp_lib_expected
+    /**
+     * Dequeue expected: Front element, or ContainerError::Empty
+     */
+    expected<T, ContainerError> dequeue_expected() {
+        if (isEmpty()) [[unlikely]] {
+            return unexpected(ContainerError::Empty);
+        }
+        return dequeue_unchecked();
+    }
+#endif
+    
+    /**
+     * Dequeue unchecked: Remove and return front element without an
+     * empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    T dequeue_unchecked() {
+        assert(!isEmpty());
+        Node<T>* temp = frontPtr;
+        T value = std::move(temp->data);
+        frontPtr = frontPtr->next;
+        
+        // If queue becomes empty
+        if (frontPtr == nullptr) {
+            rearPtr = nullptr;
+        }
+        
+        temp->~Node<T>();
+        nodeAlloc.deallocate(temp);
+        elementCount--;
+        counters.onDequeue(1);
+        Trace::log("Dequeued: ", value);
+        return value;
+    }
+    
+    /**
+     * Front: View front element without removing
+     * Time Complexity: O(1)
+     */
+    T front() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access front");
+        }
+        return frontPtr->data;
+    }
+    
+    /**
+     * Try front: Pointer to front element, or nullptr if empty
+     */
+    const T* try_front() const {
+        if (isEmpty()) [[unlikely]] {
+            return nullptr;
+        }
+        return &frontPtr->data;
+    }
+    
+    /**
+     * Front unchecked: Reference to front element without an empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    const T& front_unchecked() const {
+        assert(!isEmpty());
+        return frontPtr->data;
+    }
+    
+    /**
+     * Check if queue is empty
+     */
+    bool isEmpty() const {
+        return frontPtr == nullptr;
+    }
+    
+    /**
+     * Get current size of queue
+     */
+    int size() const {
+        return elementCount;
+    }
+    
+    /**
+     * Stats: Snapshot of the counters (all zero under NoStats)
+     */
+    StatsSnapshot stats() const {
+        return counters.snapshot();
+    }
+    
+    void resetStats() {
+        counters.reset();
+    }
+    
+    /**
+     * Enqueue range: Add every element of [first, last) in order
+     * The new nodes are linked into a private chain first and attached
+     * to the rear with one splice
+     * Time Complexity: O(n)
+     */
+    template <typename InputIt>
+    void enqueue_range(InputIt first, InputIt last) {
+        Node<T>* chainFront = nullptr;
+        Node<T>* chainRear = nullptr;
+        int n = 0;
+        try {
+            for (; first != last; ++first, n++) {
+                Node<T>* newNode = makeNode(*first);
+                if (chainRear == nullptr) {
+                    chainFront = newNode;
+                } else {
+                    chainRear->next = newNode;
+                }
+                chainRear = newNode;
+            }
+        } catch (...) {
+            // Leave the queue unchanged if copying an element throws
+            while (chainFront != nullptr) {
+                Node<T>* next = chainFront->next;
+                chainFront->~Node<T>();
+                nodeAlloc.deallocate(chainFront);
+                chainFront = next;
+            }
+            throw;
+        }
+        if (chainFront == nullptr) return;
+        
+        if (isEmpty()) {
+            frontPtr = chainFront;
+        } else {
+            rearPtr->next = chainFront;
+        }
+        rearPtr = chainRear;
+        elementCount += n;
+        counters.onEnqueue(static_cast<size_t>(n), static_cast<size_t>(elementCount));
+        Trace::log("Enqueued ", n, " elements");
+    }
+    
+    /**
+     * Dequeue n: Remove up to n elements from the front into out
+     * Returns the number of elements dequeued (fewer if the queue runs out)
+     * Time Complexity: O(n)
+     */
+    template <typename OutputIt>
+    int dequeue_n(OutputIt out, int n) {
+        int taken = 0;
+        for (; taken < n && frontPtr != nullptr; taken++, ++out) {
+            Node<T>* temp = frontPtr;
+            *out = std::move(temp->data);
+            frontPtr = frontPtr->next;
+            temp->~Node<T>();
+            nodeAlloc.deallocate(temp);
+        }
+        if (frontPtr == nullptr) {
+            rearPtr = nullptr;
+        }
+        elementCount -= taken;
+        counters.onDequeue(static_cast<size_t>(taken));
+        Trace::log("Dequeued ", taken, " elements");
+        return taken;
+    }
+    
+    /**
+     * Clear: Remove and free every node
+     */
+    void clear() {
+        while (frontPtr != nullptr) {
+            Node<T>* temp = frontPtr;
+            frontPtr = frontPtr->next;
+            temp->~Node<T>();
+            nodeAlloc.deallocate(temp);
+        }
+        rearPtr = nullptr;
+        elementCount = 0;
+        counters.onClear();
+    }
+    
+    /**
+     * Serialize: Write a binary snapshot, front to rear
+     */
+    void serialize(ostream& out) const {
+        using Codec = BinaryCodec<T>;
+        writeSnapshotHeader(out, SnapshotKind::Queue, Codec::RAW,
+                            Codec::RAW ? sizeof(T) : 0, static_cast<uint64_t>(elementCount));
+        for (Node<T>* current = frontPtr; current != nullptr; current = current->next) {
+            Codec::write(out, current->data);
+        }
+        if (!out) throw runtime_error("Snapshot write failed");
+    }
+    
+    /**
+     * Deserialize: Replace the contents with a snapshot from serialize()
+     * Trivially copyable T is loaded with a single read, then linked in
+     * with one enqueue_range splice
+     */
+    void deserialize(istream& in) {
+        using Codec = BinaryCodec<T>;
+        uint64_t n = readSnapshotHeader(in, SnapshotKind::Queue, Codec::RAW,
+                                        Codec::RAW ? sizeof(T) : 0);
+        uint64_t upfront = checkSnapshotCount(in, n, numeric_limits<int>::max(),
+                                              Codec::RAW ? sizeof(T) : 0);
+        clear();
+        if constexpr (Codec::RAW) {
+            vector<T> image;
+            for (uint64_t loaded = 0; loaded < n; loaded += image.size()) {
+                image.resize(static_cast<size_t>(n - loaded < upfront ? n - loaded : upfront));
+                streamsize bytes = static_cast<streamsize>(image.size() * sizeof(T));
+                in.read(reinterpret_cast<char*>(image.data()), bytes);
+                if (in.gcount() != bytes) throw runtime_error("Snapshot truncated: missing elements");
+                enqueue_range(image.begin(), image.end());
+            }
+        } else {
+            for (uint64_t i = 0; i < n; i++) {
+                T value = Codec::read(in);
+                if (!in) throw runtime_error("Snapshot truncated: missing elements");
+                enqueue(std::move(value));
+            }
+        }
+        Trace::log("Queue restored with ", n, " elements");
+    }
+    
+    /**
+     * Segments: Nodes are not contiguous, so each element is its own run
+     */
+    auto segments() const {
+        return [this](auto visit) {
+            for (Node<T>* current = frontPtr; current != nullptr; current = current->next) {
+                if (!visit(&current->data, size_t(1))) return;
+            }
+        };
+    }
+    
+    /**
+     * Contains: Check whether any element equals value
+     * Time Complexity: O(n), vectorized for 32-bit integers
+     */
+    bool contains(const T& value) const {
+        return find(value) != -1;
+    }
+    
+    /**
+     * Find: Distance from the front of the first element equal to value
+     * (0 means it is the next one dequeued)
+     * Returns -1 if no element equals value
+     */
+    int find(const T& value) const {
+        size_t hit = segmentsFind<T>(segments(), value);
+        return hit == NOT_FOUND ? -1 : static_cast<int>(hit);
+    }
+    
+    /**
+     * Count: Number of elements equal to value
+     */
+    int count(const T& value) const {
+        return static_cast<int>(segmentsCount<T>(segments(), value));
+    }
+    
+    /**
+     * Min / max: Smallest or largest element; throws if empty
+     */
+    T min() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot compute min");
+        }
+        return segmentsMin<T>(segments());
+    }
+    
+    T max() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot compute max");
+        }
+        return segmentsMax<T>(segments());
+    }
+    
+    /**
+     * Sum: Total of all elements (64-bit accumulator for integers)
+     */
+    SumType<T> sum() const {
+        return segmentsSum<T>(segments());
+    }
+    
+    
+    /**
+     * Display all elements (front to rear)
+     */
+    void display() const {
+        if (isEmpty()) {
+            cout << "Queue is empty" << endl;
+            return;
+        }
+        cout << "Queue (front to rear): ";
+        Node<T>* current = frontPtr;
+        while (current != nullptr) {
+            cout << current->data;
+            if (current->next != nullptr) cout << " <- ";
+            current = current->next;
+        }
+        cout << endl;
+    }
+};
+
+// ============================================================================
+// RING QUEUE IMPLEMENTATION (FIFO on a contiguous circular array)
+// ============================================================================
+
+/**
+ * Template-based Queue class using a circular array
+ * Elements live in one contiguous buffer, so enqueue/dequeue never allocate
+ * (except when growing) and traversal is cache-friendly.
+ * Capacity is always a power of two so wrap-around is a mask, not a modulo.
+ * Prefer this over the linked Queue unless stable element addresses matter.
+ * Stats selects operation counting (NoStats, ContainerStats, or custom)
+ */
+template <typename T, typename Trace = DefaultTrace, typename Stats = DefaultStats>
+class RingQueue {
+private:
+    T* buffer;           // Uninitialized storage for capacity elements
+    size_t capacity;     // Always a power of two
+    size_t mask;         // capacity - 1, used to wrap indices
+    size_t head;         // Monotonic index of front element
+    size_t tail;         // Monotonic index one past the rear element
+    allocator<T> alloc;
+    [[no_unique_address]] Stats counters;
+    
+    /**
+     * Round up to the next power of two (minimum 1)
+     */
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+    
+    /**
+     * Grow: Double the capacity (until it holds at least minCapacity) and
+     * unwrap elements into the new buffer
+     * Elements are moved when their move constructor is noexcept
+     * Time Complexity: O(n), amortized O(1) per enqueue
+     */
+    void grow(size_t minCapacity = 0) {
+        size_t newCapacity = capacity * 2;
+        while (newCapacity < minCapacity) newCapacity *= 2;
+        T* newBuffer = alloc.allocate(newCapacity);
+        size_t n = tail - head;
+        
+        // Old elements are destroyed only after every copy succeeded, so a
+        // throwing copy leaves the queue unchanged
+        size_t built = 0;
+        try {
+            for (; built < n; built++) {
+                new (&newBuffer[built]) T(move_if_noexcept(buffer[(head + built) & mask]));
+            }
+        } catch (...) {
+            for (size_t i = 0; i < built; i++) {
+                newBuffer[i].~T();
+            }
+            alloc.deallocate(newBuffer, newCapacity);
+            throw;
+        }
+        for (size_t i = 0; i < n; i++) {
+            buffer[(head + i) & mask].~T();
+        }
+        
+        alloc.deallocate(buffer, capacity);
+        buffer = newBuffer;
+        capacity = newCapacity;
+        mask = newCapacity - 1;
+        head = 0;
+        tail = n;
+        counters.onResize(n * sizeof(T));
+        Trace::log("RingQueue resized to capacity: ", capacity);
+    }
+    
+public:
+    /**
+     * Constructor: Initialize empty queue (capacity rounded up to 2^k)
+     */
+    RingQueue(size_t initialCapacity = 16) {
+        capacity = roundUpPow2(initialCapacity);
+        mask = capacity - 1;
+        buffer = alloc.allocate(capacity);
+        head = tail = 0;
+        Trace::log("RingQueue created with capacity: ", capacity);
+    }
+    
+    RingQueue(const RingQueue&) = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+    
+    /**
+     * Destructor: Destroy live elements and release the buffer
+     */
+    ~RingQueue() {
+        while (head != tail) {
+            buffer[head++ & mask].~T();
+        }
+        alloc.deallocate(buffer, capacity);
+        Trace::log("RingQueue destroyed");
+    }
+    
+    /**
+     * Enqueue: Add element to rear of queue
+     * Time Complexity: O(1) amortized
+     */
+    void enqueue(const T& value) {
+        if (tail - head == capacity) {
+            // value may refer to an element that grow() is about to move
+            T copy(value);
+            grow();
+            enqueue(std::move(copy));
+            return;
+        }
+        new (&buffer[tail & mask]) T(value);
+        tail++;
+        counters.onEnqueue(1, tail - head);
+        Trace::log("Enqueued: ", value);
+    }
+    
+    void enqueue(T&& value) {
+        if (tail - head == capacity) {
+            grow();
+        }
+        T* slot = new (&buffer[tail & mask]) T(std::move(value));
+        tail++;
+        counters.onEnqueue(1, tail - head);
+        Trace::log("Enqueued: ", *slot);
+    }
+    
+    /**
+     * Dequeue: Remove and return front element
+     * Time Complexity: O(1)
+     */
+    T dequeue() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+        }
+        return dequeue_unchecked();
+    }
+    
+    /**
+     * Try dequeue: Move front element into out; returns false if empty
+     * Never throws on an empty queue, for polling loops
+     */
+    bool try_dequeue(T& out) {
+        if (isEmpty()) [[unlikely]] {
+            return false;
+        }
+        out = dequeue_unchecked();
+        return true;
+    }
+    
+    /**
+     * Dequeue optional: Front element, or nullopt if empty
+     */
+    optional<T> dequeue_optional() {
+        if (isEmpty()) [[unlikely]] {
+            return nullopt;
+        }
+        return dequeue_unchecked();
+    }
+    
+#ifdef __cpp_lib_expected
+    /**
+     * Dequeue expected: Front element, or ContainerError::Empty
+     */
+    expected<T, ContainerError> dequeue_expected() {
+        if (isEmpty()) [[unlikely]] {
+            return unexpected(ContainerError::Empty);
+        }
+        return dequeue_unchecked();
+    }
+#endif
+    
+    /**
+     * Dequeue unchecked: Remove and return front element without an
+     * empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    T dequeue_unchecked() {
+        assert(!isEmpty());
+        T& slot = buffer[head & mask];
+        T value = std::move(slot);
+        slot.~T();
+        head++;
+        counters.onDequeue(1);
+        Trace::log("Dequeued: ", value);
+        return value;
+    }
+    
+    /**
+     * Front: View front element without removing
+     * Time Complexity: O(1)
+     */
+    const T& front() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access front");
+        }
+        return buffer[head & mask];
+    }
+    
+    /**
+     * Try front: Pointer to front element, or nullptr if empty
+     */
+    const T* try_front() const {
+        if (isEmpty()) [[unlikely]] {
+            return nullptr;
+        }
+        return &buffer[head & mask];
+    }
+    
+    /**
+     * Front unchecked: Reference to front element without an empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    const T& front_unchecked() const {
+        assert(!isEmpty());
+        return buffer[head & mask];
+    }
+    
+    /**
+     * Check if queue is empty
+     */
+    bool isEmpty() const {
+        return head == tail;
+    }
+    
+    /**
+     * Get current size of queue
+     */
+    int size() const {
+        return static_cast<int>(tail - head);
+    }
+    
+    /**
+     * Get current capacity of the circular buffer
+     */
+    size_t getCapacity() const {
+        return capacity;
+    }
+    
+    /**
+     * Stats: Snapshot of the counters (all zero under NoStats)
+     */
+    StatsSnapshot stats() const {
+        return counters.snapshot();
+    }
+    
+    void resetStats() {
+        counters.reset();
+    }
+    
+    /**
+     * Enqueue range: Add every element of [first, last) in order
+     * Capacity is reserved once for forward iterators; contiguous ranges of
+     * trivially copyable T are copied with at most two memcpy calls (one on
+     * each side of the wrap point)
+     * Time Complexity: O(n)
+     */
+    template <typename InputIt>
+    void enqueue_range(InputIt first, InputIt last) {
+        using Category = typename iterator_traits<InputIt>::iterator_category;
+        if constexpr (!is_base_of<forward_iterator_tag, Category>::value) {
+            for (; first != last; ++first) enqueue(*first);
+        } else {
+            size_t n = static_cast<size_t>(distance(first, last));
+            if (n == 0) return;
+            if (tail - head + n > capacity) {
+                grow(tail - head + n);
+            }
+            if constexpr (contiguous_iterator<InputIt> && is_trivially_copyable<T>::value &&
+                          is_same<typename remove_cv<iter_value_t<InputIt>>::type, T>::value) {
+                size_t start = tail & mask;
+                size_t firstPart = capacity - start < n ? capacity - start : n;
+                const T* src = to_address(first);
+                memcpy(static_cast<void*>(&buffer[start]), src, firstPart * sizeof(T));
+                memcpy(static_cast<void*>(buffer), src + firstPart, (n - firstPart) * sizeof(T));
+                tail += n;
+            } else {
+                // tail only moves once the whole range is built, so a
+                // throwing copy leaves the queue unchanged
+                size_t i = 0;
+                try {
+                    for (; i < n; i++, ++first) {
+                        new (&buffer[(tail + i) & mask]) T(*first);
+                    }
+                } catch (...) {
+                    while (i > 0) {
+                        i--;
+                        buffer[(tail + i) & mask].~T();
+                    }
+                    throw;
+                }
+                tail += n;
+            }
+            counters.onEnqueue(n, tail - head);
+            Trace::log("Enqueued ", n, " elements");
+        }
+    }
+    
+    /**
+     * Dequeue n: Remove up to n elements from the front into out
+     * Returns the number of elements dequeued (fewer if the queue runs out)
+     * Time Complexity: O(n)
+     */
+    template <typename OutputIt>
+    size_t dequeue_n(OutputIt out, size_t n) {
+        size_t taken = n < tail - head ? n : tail - head;
+        for (size_t i = 0; i < taken; i++, ++out) {
+            T& slot = buffer[head & mask];
+            *out = std::move(slot);
+            slot.~T();
+            head++;
+        }
+        counters.onDequeue(taken);
+        Trace::log("Dequeued ", taken, " elements");
+        return taken;
+    }
+    
+    /**
+     * For each segment: Visit contents as contiguous runs, front to rear
+     * visit(const T* run, size_t length) returns false to stop early.
+     * The buffer holds at most two runs, split at the wrap point.
+     */
+    template <typename F>
+    void forEachSegment(F visit) const {
+        size_t n = tail - head;
+        if (n == 0) return;
+        size_t start = head & mask;
+        size_t firstPart = capacity - start < n ? capacity - start : n;
+        if (!visit(static_cast<const T*>(&buffer[start]), firstPart)) return;
+        if (n > firstPart) visit(static_cast<const T*>(buffer), n - firstPart);
+    }
+    
+    auto segments() const {
+        return [this](auto visit) { forEachSegment(visit); };
+    }
+    
+    /**
+     * Contains: Check whether any element equals value
+     * Time Complexity: O(n), vectorized for 32-bit integers
+     */
+    bool contains(const T& value) const {
+        return find(value) != -1;
+    }
+    
+    /**
+     * Find: Distance from the front of the first element equal to value
+     * (0 means it is the next one dequeued)
+     * Returns -1 if no element equals value
+     */
+    int find(const T& value) const {
+        size_t hit = segmentsFind<T>(segments(), value);
+        return hit == NOT_FOUND ? -1 : static_cast<int>(hit);
+    }
+    
+    /**
+     * Count: Number of elements equal to value
+     */
+    int count(const T& value) const {
+        return static_cast<int>(segmentsCount<T>(segments(), value));
+    }
+    
+    /**
+     * Min / max: Smallest or largest element; throws if empty
+     */
+    T min() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot compute min");
+        }
+        return segmentsMin<T>(segments());
+    }
+    
+    T max() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot compute max");
+        }
+        return segmentsMax<T>(segments());
+    }
+    
+    /**
+     * Sum: Total of all elements (64-bit accumulator for integers)
+     */
+    SumType<T> sum() const {
+        return segmentsSum<T>(segments());
+    }
+    
+    
+    /**
+     * Display all elements (front to rear)
+     */
+    void display() const {
+        if (isEmpty()) {
+            cout << "Queue is empty" << endl;
+            return;
+        }
+        cout << "Queue (front to rear): ";
+        for (size_t i = head; i != tail; i++) {
+            cout << buffer[i & mask];
+            if (i + 1 != tail) cout << " <- ";
+        }
+        cout << endl;
+    }
+};
+
+// ============================================================================
+// CHUNKED QUEUE IMPLEMENTATION (unrolled linked list of fixed-size blocks)
+// ============================================================================
+
+/**
+ * Template-based Queue class using a linked list of ~4 KB blocks
+ * Each block holds BLOCK_ELEMENTS elements in a contiguous array, so
+ * traversal is sequential within a block and the link cost is paid once
+ * per block instead of once per element. Growing links a new block and
+ * never moves existing elements (unlike RingQueue), so it suits very
+ * large queues. Emptied blocks are kept in a small free pool and reused.
+ */
+template <typename T, typename Trace = DefaultTrace>
+class ChunkedQueue {
+public:
+    static constexpr size_t BLOCK_BYTES = 4096;
+    static constexpr size_t BLOCK_ELEMENTS = sizeof(T) >= BLOCK_BYTES ? 1 : BLOCK_BYTES / sizeof(T);
+    
+private:
+    struct Block {
+        Block* next;
+        alignas(T) unsigned char storage[BLOCK_ELEMENTS * sizeof(T)];
+        
+        T* slot(size_t i) {
+            return reinterpret_cast<T*>(storage) + i;
+        }
+    };
+    
+    Block* frontBlock;   // Block holding the front element
+    Block* rearBlock;    // Block receiving the next enqueue
+    size_t frontIndex;   // Position of front element within frontBlock
+    size_t rearIndex;    // Next free position within rearBlock
+    size_t elementCount; // Number of elements
+    Block* spareBlocks;  // Free pool of emptied blocks
+    size_t spareCount;
+    size_t maxSpare;     // Pool limit; extra emptied blocks are freed
+    
+    Block* takeBlock() {
+        Block* block;
+        if (spareBlocks != nullptr) {
+            block = spareBlocks;
+            spareBlocks = block->next;
+            spareCount--;
+        } else {
+            block = new Block;
+            Trace::log("ChunkedQueue allocated block of ", BLOCK_ELEMENTS, " elements");
+        }
+        block->next = nullptr;
+        return block;
+    }
+    
+    void recycleBlock(Block* block) {
+        if (spareCount < maxSpare) {
+            block->next = spareBlocks;
+            spareBlocks = block;
+            spareCount++;
+        } else {
+            delete block;
+        }
+    }
+    
+    /**
+     * Make room for one element at the rear
+     */
+    void ensureRearSlot() {
+        if (rearIndex == BLOCK_ELEMENTS) {
+            Block* block = takeBlock();
+            rearBlock->next = block;
+            rearBlock = block;
+            rearIndex = 0;
+        }
+    }
+    
+    /**
+     * Drop the front element's slot, releasing its block when emptied
+     */
+    void advanceFront() {
+        frontIndex++;
+        elementCount--;
+        if (frontIndex == BLOCK_ELEMENTS) {
+            Block* emptied = frontBlock;
+            frontBlock = frontBlock->next;
+            frontIndex = 0;
+            recycleBlock(emptied);
+        } else if (elementCount == 0) {
+            // Single block, now empty: rewind instead of moving on
+            frontIndex = rearIndex = 0;
+        }
+        if (frontBlock == nullptr) {
+            // The emptied block was also the rear one
+            frontBlock = rearBlock = takeBlock();
+            frontIndex = rearIndex = 0;
+        }
+    }
+    
+public:
+    /**
+     * Constructor: Initialize empty queue with one block
+     */
+    explicit ChunkedQueue(size_t maxSpareBlocks = 8)
+        : frontIndex(0), rearIndex(0), elementCount(0), spareBlocks(nullptr),
+          spareCount(0), maxSpare(maxSpareBlocks) {
+        frontBlock = rearBlock = new Block;
+        frontBlock->next = nullptr;
+        Trace::log("ChunkedQueue created");
+    }
+    
+    ChunkedQueue(const ChunkedQueue&) = delete;
+    ChunkedQueue& operator=(const ChunkedQueue&) = delete;
+    
+    /**
+     * Destructor: Destroy elements and free every block
+     */
+    ~ChunkedQueue() {
+        while (elementCount > 0) {
+            frontBlock->slot(frontIndex)->~T();
+            advanceFront();
+        }
+        delete frontBlock;  // Last (empty) block
+        while (spareBlocks != nullptr) {
+            Block* next = spareBlocks->next;
+            delete spareBlocks;
+            spareBlocks = next;
+        }
+        Trace::log("ChunkedQueue destroyed");
+    }
+    
+    /**
+     * Emplace: Construct element at rear of queue
+     * Time Complexity: O(1), never moves existing elements
+     */
+    template <typename... Args>
+    T& emplace(Args&&... args) {
+        ensureRearSlot();
+        T* slot = new (rearBlock->slot(rearIndex)) T(std::forward<Args>(args)...);
+        rearIndex++;
+        elementCount++;
+        Trace::log("Enqueued: ", *slot);
+        return *slot;
+    }
+    
+    /**
+     * Enqueue: Add element to rear of queue
+     * Time Complexity: O(1)
+     */
+    void enqueue(const T& value) {
+        emplace(value);
+    }
+    
+    void enqueue(T&& value) {
+        emplace(std::move(value));
+    }
+    
+    /**
+     * Dequeue: Remove and return front element
+     * Time Complexity: O(1)
+     */
+    T dequeue() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+        }
+        return dequeue_unchecked();
+    }
+    
+    /**
+     * Try dequeue: Move front element into out; returns false if empty
+     * Never throws on an empty queue, for polling loops
+     */
+    bool try_dequeue(T& out) {
+        if (isEmpty()) [[unlikely]] {
+            return false;
+        }
+        out = dequeue_unchecked();
+        return true;
+    }
+    
+    /**
+     * Dequeue optional: Front element, or nullopt if empty
+     */
+    optional<T> dequeue_optional() {
+        if (isEmpty()) [[unlikely]] {
+            return nullopt;
+        }
+        return dequeue_unchecked();
+    }
+    
+#ifdef __cpp_lib_expected
+    /**
+     * Dequeue expected: Front element, or ContainerError::Empty
+     */
+    expected<T, ContainerError> dequeue_expected() {
+        if (isEmpty()) [[unlikely]] {
+            return unexpected(ContainerError::Empty);
+        }
+        return dequeue_unchecked();
+    }
+#endif
+    
+    /**
+     * Dequeue unchecked: Remove and return front element without an
+     * empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    T dequeue_unchecked() {
+        assert(!isEmpty());
+        T* slot = frontBlock->slot(frontIndex);
+        T value = std::move(*slot);
+        slot->~T();
+        advanceFront();
+        Trace::log("Dequeued: ", value);
+        return value;
+    }
+    
+    /**
+     * Front: View front element without removing
+     * Time Complexity: O(1)
+     */
+    const T& front() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access front");
+        }
+        return *frontBlock->slot(frontIndex);
+    }
+    
+    /**
+     * Try front: Pointer to front element, or nullptr if empty
+     */
+    const T* try_front() const {
+        if (isEmpty()) [[unlikely]] {
+            return nullptr;
+        }
+        return &*frontBlock->slot(frontIndex);
+    }
+    
+    /**
+     * Front unchecked: Reference to front element without an empty check
+     * Precondition: !isEmpty() (checked only by assert in debug builds)
+     */
+    const T& front_unchecked() const {
+        assert(!isEmpty());
+        return *frontBlock->slot(frontIndex);
+    }
+    
+    /**
+     * Check if queue is empty
+     */
+    bool isEmpty() const {
+        return elementCount == 0;
+    }
+    
+    /**
+     * Get current size of queue
+     */
+    int size() const {
+        return static_cast<int>(elementCount);
+    }
+    
+    /**
+     * For each: Visit elements front to rear, block by block
+     */
+    template <typename F>
+    void forEach(F visit) const {
+        Block* block = frontBlock;
+        size_t index = frontIndex;
+        for (size_t remaining = elementCount; remaining > 0; remaining--) {
+            if (index == BLOCK_ELEMENTS) {
+                block = block->next;
+                index = 0;
+            }
+            visit(static_cast<const T&>(*block->slot(index++)));
+        }
+    }
+    
+    /**
+     * For each segment: Visit contents as contiguous runs, one per block
+     * visit(const T* run, size_t length) returns false to stop early.
+     */
+    template <typename F>
+    void forEachSegment(F visit) const {
+        Block* block = frontBlock;
+        size_t index = frontIndex;
+        size_t remaining = elementCount;
+        while (remaining > 0) {
+            if (index == BLOCK_ELEMENTS) {
+                block = block->next;
+                index = 0;
+            }
+            size_t run = BLOCK_ELEMENTS - index < remaining ? BLOCK_ELEMENTS - index : remaining;
+            if (!visit(static_cast<const T*>(block->slot(index)), run)) return;
+            index += run;
+            remaining -= run;
+        }
+    }
+    
+    auto segments() const {
+        return [this](auto visit) { forEachSegment(visit); };
+    }
+    
+    /**
+     * Contains: Check whether any element equals value
+     * Time Complexity: O(n), vectorized for 32-bit integers
+     */
+    bool contains(const T& value) const {
+        return find(value) != -1;
+    }
+    
+    /**
+     * Find: Distance from the front of the first element equal to value
+     * (0 means it is the next one dequeued)
+     * Returns -1 if no element equals value
+     */
+    int find(const T& value) const {
+        size_t hit = segmentsFind<T>(segments(), value);
+        return hit == NOT_FOUND ? -1 : static_cast<int>(hit);
+    }
+    
+    /**
+     * Count: Number of elements equal to value
+     */
+    int count(const T& value) const {
+        return static_cast<int>(segmentsCount<T>(segments(), value));
+    }
+    
+    /**
+     * Min / max: Smallest or largest element; throws if empty
+     */
+    T min() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot compute min");
+        }
+        return segmentsMin<T>(segments());
+    }
+    
+    T max() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot compute max");
+        }
+        return segmentsMax<T>(segments());
+    }
+    
+    /**
+     * Sum: Total of all elements (64-bit accumulator for integers)
+     */
+    SumType<T> sum() const {
+        return segmentsSum<T>(segments());
+    }
+    
+    
+    /**
+     * Display all elements (front to rear)
+     */
+    void display() const {
+        if (isEmpty()) {
+            cout << "Queue is empty" << endl;
+            return;
+        }
+        cout << "Queue (front to rear): ";
+        size_t printed = 0;
+        forEach([&](const T& value) {
+            cout << value;
+            if (++printed < elementCount) cout << " <- ";
+        });
+        cout << endl;
+    }
+};
+
+// ============================================================================
+// INTRUSIVE QUEUE AND STACK (elements carry their own links)
+// ============================================================================
+
+/**
+ * Link embedded in an element by inheriting from it
+ *   struct Message : IntrusiveHook<> { ... };
+ * Tag allows one object to sit in several containers at once:
+ *   struct Job : IntrusiveHook<struct ReadyTag>, IntrusiveHook<struct DoneTag> { ... };
+ */
+template <typename Tag = void>
+struct IntrusiveHook {
+    IntrusiveHook* next = nullptr;
+};
+
+/**
+ * FIFO of caller-owned objects linked through their IntrusiveHook
+ * The queue never allocates, copies or destroys elements: enqueue and
+ * dequeue are pointer updates, and splice() moves a whole queue in O(1).
+ * An object may be in at most one container per Tag at a time, and must
+ * outlive its stay in the queue.
+ */
+template <typename T, typename Tag = void>
+class IntrusiveQueue {
+    static_assert(is_base_of<IntrusiveHook<Tag>, T>::value,
+                  "IntrusiveQueue<T, Tag> needs T to inherit IntrusiveHook<Tag>");
+    
+private:
+    using Hook = IntrusiveHook<Tag>;
+    
+    Hook* frontHook;
+    Hook* rearHook;
+    size_t count;
+    
+    static Hook* hookOf(T& item) {
+        return static_cast<Hook*>(&item);
+    }
+    
+    static T& itemOf(Hook* hook) {
+        return *static_cast<T*>(hook);
+    }
+    
+public:
+    IntrusiveQueue() : frontHook(nullptr), rearHook(nullptr), count(0) {}
+    
+    IntrusiveQueue(const IntrusiveQueue&) = delete;
+    IntrusiveQueue& operator=(const IntrusiveQueue&) = delete;
+    
+    /**
+     * Destructor: Unlinks the elements (it does not own them)
+     */
+    ~IntrusiveQueue() {
+        clear();
+    }
+    
+    /**
+     * Enqueue: Link item at the rear
+     * Time Complexity: O(1), no allocation
+     */
+    void enqueue(T& item) {
+        Hook* hook = hookOf(item);
+        assert(hook->next == nullptr && hook != rearHook && "element is already linked");
+        hook->next = nullptr;
+        if (rearHook == nullptr) {
+            frontHook = hook;
+        } else {
+            rearHook->next = hook;
+        }
+        rearHook = hook;
+        count++;
+    }
+    
+    /**
+     * Dequeue: Unlink and return the front element
+     * Time Complexity: O(1)
+     */
+    T& dequeue() {
+        T* item = try_dequeue();
+        if (item == nullptr) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+        }
+        return *item;
+    }
+    
+    /**
+     * Try dequeue: Front element, or nullptr if empty
+     */
+    T* try_dequeue() {
+        if (frontHook == nullptr) [[unlikely]] {
+            return nullptr;
+        }
+        Hook* hook = frontHook;
+        frontHook = hook->next;
+        if (frontHook == nullptr) rearHook = nullptr;
+        hook->next = nullptr;
+        count--;
+        return &itemOf(hook);
+    }
+    
+    /**
+     * Front: View front element without removing
+     */
+    T& front() const {
+        if (frontHook == nullptr) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access front");
+        }
+        return itemOf(frontHook);
+    }
+    
+    /**
+     * Splice: Move every element of other to the rear of this queue
+     * Order is preserved and other is left empty
+     * Time Complexity: O(1)
+     */
+    void splice(IntrusiveQueue& other) {
+        if (&other == this || other.frontHook == nullptr) return;
+        if (rearHook == nullptr) {
+            frontHook = other.frontHook;
+        } else {
+            rearHook->next = other.frontHook;
+        }
+        rearHook = other.rearHook;
+        count += other.count;
+        other.frontHook = other.rearHook = nullptr;
+        other.count = 0;
+    }
+    
+    /**
+     * For each: Visit elements front to rear
+     */
+    template <typename F>
+    void forEach(F visit) const {
+        for (Hook* hook = frontHook; hook != nullptr; hook = hook->next) {
+            visit(itemOf(hook));
+        }
+    }
+    
+    /**
+     * Clear: Unlink every element so it can be linked elsewhere
+     * Time Complexity: O(n)
+     */
+    void clear() {
+        while (try_dequeue() != nullptr) {
+        }
+    }
+    
+    bool isEmpty() const {
+        return frontHook == nullptr;
+    }
+    
+    int size() const {
+        return static_cast<int>(count);
+    }
+};
+
+/**
+ * LIFO of caller-owned objects linked through their IntrusiveHook
+ * Same ownership rules as IntrusiveQueue. The bottom element is tracked
+ * so splice() can stack a whole other stack on top in O(1).
+ */
+template <typename T, typename Tag = void>
+class IntrusiveStack {
+    static_assert(is_base_of<IntrusiveHook<Tag>, T>::value,
+                  "IntrusiveStack<T, Tag> needs T to inherit IntrusiveHook<Tag>");
+    
+private:
+    using Hook = IntrusiveHook<Tag>;
+    
+    Hook* topHook;
+    Hook* bottomHook;
+    size_t count;
+    
+    static Hook* hookOf(T& item) {
+        return static_cast<Hook*>(&item);
+    }
+    
+    static T& itemOf(Hook* hook) {
+        return *static_cast<T*>(hook);
+    }
+    
+public:
+    IntrusiveStack() : topHook(nullptr), bottomHook(nullptr), count(0) {}
+    
+    IntrusiveStack(const IntrusiveStack&) = delete;
+    IntrusiveStack& operator=(const IntrusiveStack&) = delete;
+    
+    ~IntrusiveStack() {
+        clear();
+    }
+    
+    /**
+     * Push: Link item on top
+     * Time Complexity: O(1), no allocation
+     */
+    void push(T& item) {
+        Hook* hook = hookOf(item);
+        assert(hook->next == nullptr && hook != bottomHook && "element is already linked");
+        hook->next = topHook;
+        if (topHook == nullptr) bottomHook = hook;
+        topHook = hook;
+        count++;
+    }
+    
+    /**
+     * Pop: Unlink and return the top element
+     * Time Complexity: O(1)
+     */
+    T& pop() {
+        T* item = try_pop();
+        if (item == nullptr) [[unlikely]] {
+            throw runtime_error("Stack Underflow: Cannot pop from empty stack");
+        }
+        return *item;
+    }
+    
+    /**
+     * Try pop: Top element, or nullptr if empty
+     */
+    T* try_pop() {
+        if (topHook == nullptr) [[unlikely]] {
+            return nullptr;
+        }
+        Hook* hook = topHook;
+        topHook = hook->next;
+        if (topHook == nullptr) bottomHook = nullptr;
+        hook->next = nullptr;
+        count--;
+        return &itemOf(hook);
+    }
+    
+    /**
+     * Peek: View top element without removing
+     */
+    T& peek() const {
+        if (topHook == nullptr) [[unlikely]] {
+            throw runtime_error("Stack is empty: Cannot peek");
+        }
+        return itemOf(topHook);
+    }
+    
+    /**
+     * Splice: Place all of other on top of this stack, keeping other's
+     * order (its top becomes the new top); other is left empty
+     * Time Complexity: O(1)
+     */
+    void splice(IntrusiveStack& other) {
+        if (&other == this || other.topHook == nullptr) return;
+        other.bottomHook->next = topHook;
+        if (topHook == nullptr) bottomHook = other.bottomHook;
+        topHook = other.topHook;
+        count += other.count;
+        other.topHook = other.bottomHook = nullptr;
+        other.count = 0;
+    }
+    
+    /**
+     * For each: Visit elements top to bottom
+     */
+    template <typename F>
+    void forEach(F visit) const {
+        for (Hook* hook = topHook; hook != nullptr; hook = hook->next) {
+            visit(itemOf(hook));
+        }
+    }
+    
+    void clear() {
+        while (try_pop() != nullptr) {
+        }
+    }
+    
+    bool isEmpty() const {
+        return topHook == nullptr;
+    }
+    
+    int size() const {
+        return static_cast<int>(count);
+    }
+};
+
+// ============================================================================
+// PERSISTENT STACK AND QUEUE (immutable, structurally shared versions)
+// ============================================================================
+
+/**
+ * Immutable LIFO stack as a shared cons list
+ * push() and pop() leave this version untouched and return a new one that
+ * shares every existing cell, so copying a stack (taking a snapshot) is a
+ * reference-count increment: O(1) time and memory regardless of size.
+ * Versions are safe to read and derive from concurrently; cells are freed
+ * once no version reaches them.
+ */
+template <typename T>
+class PersistentStack {
+private:
+    struct Cell {
+        T value;
+        // Only stolen during teardown, never changed while reachable
+        mutable shared_ptr<const Cell> next;
+        
+        Cell(T v, shared_ptr<const Cell> n) : value(std::move(v)), next(std::move(n)) {}
+        
+        /**
+         * Destructor: Frees exclusively owned successors in a loop, so
+         * dropping a million-cell list does not recurse a million deep
+         */
+        ~Cell() {
+            shared_ptr<const Cell> rest = std::move(next);
+            while (rest && rest.use_count() == 1) {
+                shared_ptr<const Cell> after = std::move(rest->next);
+                rest = std::move(after);
+            }
+        }
+    };
+    
+    shared_ptr<const Cell> head;
+    size_t count;
+    
+    PersistentStack(shared_ptr<const Cell> h, size_t n) : head(std::move(h)), count(n) {}
+    
+    template <typename U>
+    friend class PersistentQueue;
+    
+public:
+    PersistentStack() : count(0) {}
+    
+    /**
+     * Push: New version with value on top
+     * Time Complexity: O(1), one allocation
+     */
+    [[nodiscard]] PersistentStack push(T value) const {
+        return PersistentStack(make_shared<const Cell>(std::move(value), head), count + 1);
+    }
+    
+    /**
+     * Pop: New version without the top element (this one keeps it)
+     * Time Complexity: O(1), no allocation
+     */
+    [[nodiscard]] PersistentStack pop() const {
+        if (head == nullptr) [[unlikely]] {
+            throw runtime_error("Stack Underflow: Cannot pop from empty stack");
+        }
+        return PersistentStack(head->next, count - 1);
+    }
+    
+    /**
+     * Top: View top element
+     * Time Complexity: O(1)
+     */
+    const T& top() const {
+        if (head == nullptr) [[unlikely]] {
+            throw runtime_error("Stack is empty: Cannot access top");
+        }
+        return head->value;
+    }
+    
+    /**
+     * Reversed: New version with the order flipped
+     * Time Complexity: O(n)
+     */
+    [[nodiscard]] PersistentStack reversed() const {
+        PersistentStack result;
+        forEach([&](const T& value) { result = result.push(value); });
+        return result;
+    }
+    
+    /**
+     * Shares with: True if both versions are the same list (O(1) equality
+     * for snapshots taken from one another)
+     */
+    bool sharesWith(const PersistentStack& other) const {
+        return head == other.head;
+    }
+    
+    /**
+     * For each: Visit elements top to bottom
+     */
+    template <typename F>
+    void forEach(F visit) const {
+        for (const Cell* cell = head.get(); cell != nullptr; cell = cell->next.get()) {
+            visit(cell->value);
+        }
+    }
+    
+    bool isEmpty() const {
+        return head == nullptr;
+    }
+    
+    int size() const {
+        return static_cast<int>(count);
+    }
+    
+    void display() const {
+        cout << "Persistent stack (top -> bottom): ";
+        forEach([](const T& value) { cout << value << " "; });
+        cout << endl;
+    }
+};
+
+/**
+ * Immutable FIFO queue with worst-case O(1) operations (Okasaki's
+ * real-time queue)
+ * The front is a lazy stream and the rear a PersistentStack. When the rear
+ * outgrows the front, a rotation front ++ reverse(rear) is scheduled as an
+ * unevaluated stream, and every later enqueue/dequeue forces exactly one
+ * more cell of it. Forced cells are memoized, so no version ever pays for
+ * the same reversal twice: unlike a plain two-list queue, dequeuing the
+ * same old snapshot repeatedly stays O(1). Copying a queue is O(1).
+ * Versions are safe to share across threads (forcing runs once per cell).
+ */
+template <typename T>
+class PersistentQueue {
+private:
+    using List = shared_ptr<const typename PersistentStack<T>::Cell>;
+    struct Node;
+    using Stream = shared_ptr<Node>;
+    
+    /**
+     * Stream cell: Either evaluated (value + tail, or end of stream when
+     * empty) or a pending rotate(front, rear, accumulated)
+     */
+    struct Node {
+        once_flag forced;
+        Stream pendingFront;
+        List pendingRear;
+        Stream pendingAccumulated;
+        optional<T> value;
+        Stream tail;
+        
+        Node() = default;
+        Node(T v, Stream t) : value(std::move(v)), tail(std::move(t)) {
+            call_once(forced, [] {});
+        }
+        
+        /**
+         * Destructor: Frees exclusively owned tails in a loop (see
+         * PersistentStack::Cell)
+         */
+        ~Node() {
+            Stream rest = std::move(tail);
+            while (rest && rest.use_count() == 1) {
+                Stream after = std::move(rest->tail);
+                rest = std::move(after);
+            }
+        }
+    };
+    
+    Stream front;          // lazy: front ++ reverse(rear) still being built
+    List rear;             // newest element first
+    Stream schedule;       // next unforced cell of front, if any
+    size_t frontCount;
+    size_t rearCount;
+    
+    /**
+     * Force: Evaluate a stream cell once; a pending rotation step forces
+     * only the head of its front, which the schedule has already evaluated
+     */
+    static Node& force(const Stream& stream) {
+        Node& node = *stream;
+        call_once(node.forced, [&node] {
+            if (!node.pendingFront) {
+                // Front exhausted: the rotation ends with the last rear element
+                node.value.emplace(node.pendingRear->value);
+                node.tail = std::move(node.pendingAccumulated);
+            } else {
+                Node& first = force(node.pendingFront);
+                node.value.emplace(*first.value);
+                node.tail = rotate(first.tail, node.pendingRear->next,
+                                   make_shared<Node>(node.pendingRear->value,
+                                                     std::move(node.pendingAccumulated)));
+            }
+            node.pendingFront.reset();
+            node.pendingRear.reset();
+        });
+        return node;
+    }
+    
+    /**
+     * Rotate: Suspended front ++ reverse(rear) ++ accumulated, valid when
+     * rear holds exactly one more element than front
+     */
+    static Stream rotate(Stream f, List r, Stream a) {
+        Stream node = make_shared<Node>();
+        node->pendingFront = std::move(f);
+        node->pendingRear = std::move(r);
+        node->pendingAccumulated = std::move(a);
+        return node;
+    }
+    
+    PersistentQueue(Stream f, size_t fCount, List r, size_t rCount, Stream s)
+        : front(std::move(f)), rear(std::move(r)), schedule(std::move(s)),
+          frontCount(fCount), rearCount(rCount) {}
+    
+    /**
+     * Exec: Advance the schedule by one cell, or start a rotation once it
+     * is exhausted (invariant: unforced front cells == frontCount - rearCount)
+     */
+    static PersistentQueue exec(Stream f, size_t fCount, List r, size_t rCount, Stream s) {
+        if (s) {
+            Stream next = force(s).tail;
+            return PersistentQueue(std::move(f), fCount, std::move(r), rCount, std::move(next));
+        }
+        Stream rotated = rotate(std::move(f), std::move(r), nullptr);
+        Stream scheduleHead = rotated;
+        return PersistentQueue(std::move(rotated), fCount + rCount, nullptr, 0,
+                               std::move(scheduleHead));
+    }
+    
+public:
+    PersistentQueue() : frontCount(0), rearCount(0) {}
+    
+    /**
+     * Enqueue: New version with value at the rear
+     * Time Complexity: O(1) worst case
+     */
+    [[nodiscard]] PersistentQueue enqueue(T value) const {
+        List r = make_shared<const typename PersistentStack<T>::Cell>(std::move(value), rear);
+        return exec(front, frontCount, std::move(r), rearCount + 1, schedule);
+    }
+    
+    /**
+     * Dequeue: New version without the front element (this one keeps it)
+     * Time Complexity: O(1) worst case
+     */
+    [[nodiscard]] PersistentQueue dequeue() const {
+        if (frontCount == 0) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+        }
+        return exec(force(front).tail, frontCount - 1, rear, rearCount, schedule);
+    }
+    
+    /**
+     * Get front: View front element
+     * Time Complexity: O(1) worst case
+     */
+    const T& getFront() const {
+        if (frontCount == 0) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access front");
+        }
+        return *force(front).value;
+    }
+    
+    /**
+     * For each: Visit elements front to rear
+     * Time Complexity: O(n); forces (and memoizes) the pending rotation
+     */
+    template <typename F>
+    void forEach(F visit) const {
+        size_t remaining = frontCount;
+        for (Stream cell = front; remaining > 0; remaining--) {
+            Node& node = force(cell);
+            visit(*node.value);
+            cell = node.tail;
+        }
+        PersistentStack<T>(rear, rearCount).reversed().forEach(visit);
+    }
+    
+    bool isEmpty() const {
+        return frontCount == 0;
+    }
+    
+    int size() const {
+        return static_cast<int>(frontCount + rearCount);
+    }
+    
+    void display() const {
+        cout << "Persistent queue (front -> rear): ";
+        forEach([](const T& value) { cout << value << " "; });
+        cout << endl;
+    }
+};
+
+// ============================================================================
+// PRIORITY QUEUE AND MONOTONIC QUEUE (contiguous, policy-driven storage)
+// ============================================================================
+
+/**
+ * Cache-friendly d-ary heap priority queue with decrease-key
+ * Arity children per node (4 by default) makes the tree shallower than a
+ * binary heap, and the children of a node are adjacent in memory, so a
+ * sift-down touches fewer cache lines. Compare(a, b) == true means a
+ * comes out before b: with less<T> this is a min-heap (the opposite of
+ * std::priority_queue). push() returns a Handle that stays valid until the
+ * element is popped and can be passed to decrease_key()/update().
+ * Storage uses Alloc and grows by the same Growth policies as Stack.
+ */
+template <typename T, typename Compare = less<T>, int Arity = 4,
+          typename Alloc = allocator<T>, typename Growth = DoublingGrowth>
+class DaryHeap {
+    static_assert(Arity >= 2, "DaryHeap needs at least two children per node");
+    
+public:
+    /**
+     * Stable reference to an element inside the heap
+     */
+    struct Handle {
+        size_t id;
+    };
+    
+private:
+    struct Entry {
+        T value;
+        size_t handle;   // Index into positions
+    };
+    
+    using EntryAlloc = typename allocator_traits<Alloc>::template rebind_alloc<Entry>;
+    using EntryTraits = allocator_traits<EntryAlloc>;
+    using IndexAlloc = typename allocator_traits<Alloc>::template rebind_alloc<size_t>;
+    
+    static constexpr size_t NO_POSITION = static_cast<size_t>(-1);
+    
+    Entry* entries;
+    int count;
+    int capacity;
+    EntryAlloc alloc;
+    vector<size_t, IndexAlloc> positions;    // handle -> entry index
+    vector<size_t, IndexAlloc> freeHandles;  // Recycled handle ids
+    Compare compare;
+    
+    void grow() {
+        int newCapacity = Growth::grow(capacity, count + 1);
+        Entry* newEntries = EntryTraits::allocate(alloc, newCapacity);
+        // Copy when the move may throw; old entries die only after success
+        int built = 0;
+        try {
+            for (; built < count; built++) {
+                EntryTraits::construct(alloc, &newEntries[built], move_if_noexcept(entries[built]));
+            }
+        } catch (...) {
+            for (int i = 0; i < built; i++) {
+                EntryTraits::destroy(alloc, &newEntries[i]);
+            }
+            EntryTraits::deallocate(alloc, newEntries, newCapacity);
+            throw;
+        }
+        for (int i = 0; i < count; i++) {
+            EntryTraits::destroy(alloc, &entries[i]);
+        }
+        if (entries != nullptr) EntryTraits::deallocate(alloc, entries, capacity);
+        entries = newEntries;
+        capacity = newCapacity;
+    }
+    
+    /**
+     * Move the entry at index i up until its parent comes first
+     * The entry is held aside and parents slide down into the hole.
+     */
+    void siftUp(size_t i) {
+        Entry moving = std::move(entries[i]);
+        while (i > 0) {
+            size_t parent = (i - 1) / Arity;
+            if (!compare(moving.value, entries[parent].value)) break;
+            entries[i] = std::move(entries[parent]);
+            positions[entries[i].handle] = i;
+            i = parent;
+        }
+        entries[i] = std::move(moving);
+        positions[entries[i].handle] = i;
+    }
+    
+    /**
+     * Move the entry at index i down below any child that comes first
+     */
+    void siftDown(size_t i) {
+        size_t n = static_cast<size_t>(count);
+        Entry moving = std::move(entries[i]);
+        while (true) {
+            size_t firstChild = i * Arity + 1;
+            if (firstChild >= n) break;
+            size_t lastChild = firstChild + Arity < n ? firstChild + Arity : n;
+            size_t best = firstChild;
+            for (size_t c = firstChild + 1; c < lastChild; c++) {
+                if (compare(entries[c].value, entries[best].value)) best = c;
+            }
+            if (!compare(entries[best].value, moving.value)) break;
+            entries[i] = std::move(entries[best]);
+            positions[entries[i].handle] = i;
+            i = best;
+        }
+        entries[i] = std::move(moving);
+        positions[entries[i].handle] = i;
+    }
+    
+    size_t checkedPosition(Handle h) const {
+        if (h.id >= positions.size() || positions[h.id] == NO_POSITION) {
+            throw runtime_error("DaryHeap: handle does not refer to a queued element");
+        }
+        return positions[h.id];
+    }
+    
+public:
+    /**
+     * Constructor: Initialize empty heap with room for initialCapacity
+     */
+    explicit DaryHeap(int initialCapacity = 16, const Compare& cmp = Compare(),
+                      const Alloc& allocator = Alloc())
+        : entries(nullptr), count(0), capacity(0), alloc(allocator),
+          positions(IndexAlloc(allocator)), freeHandles(IndexAlloc(allocator)), compare(cmp) {
+        if (initialCapacity > 0) {
+            entries = EntryTraits::allocate(alloc, initialCapacity);
+            capacity = initialCapacity;
+        }
+    }
+    
+    DaryHeap(const DaryHeap&) = delete;
+    DaryHeap& operator=(const DaryHeap&) = delete;
+    
+    ~DaryHeap() {
+        for (int i = 0; i < count; i++) {
+            EntryTraits::destroy(alloc, &entries[i]);
+        }
+        if (entries != nullptr) EntryTraits::deallocate(alloc, entries, capacity);
+    }
+    
+    /**
+     * Push: Insert element and return its handle
+     * Time Complexity: O(log_d n)
+     */
+    Handle push(T value) {
+        if (count == capacity) {
+            grow();
+        }
+        size_t id;
+        if (!freeHandles.empty()) {
+            id = freeHandles.back();
+            freeHandles.pop_back();
+        } else {
+            id = positions.size();
+            positions.push_back(NO_POSITION);
+        }
+        EntryTraits::construct(alloc, &entries[count], Entry{std::move(value), id});
+        count++;
+        siftUp(static_cast<size_t>(count - 1));
+        return Handle{id};
+    }
+    
+    /**
+     * Top: View the element that comes out first
+     * Time Complexity: O(1)
+     */
+    const T& top() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Priority queue is empty: Cannot access top");
+        }
+        return entries[0].value;
+    }
+    
+    /**
+     * Pop: Remove and return the element that comes out first
+     * Time Complexity: O(d log_d n)
+     */
+    T pop() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Priority queue Underflow: Cannot pop from empty queue");
+        }
+        T value = std::move(entries[0].value);
+        positions[entries[0].handle] = NO_POSITION;
+        freeHandles.push_back(entries[0].handle);
+        count--;
+        if (count > 0) {
+            // Walk the hole at the root down to a leaf, promoting the first
+            // child each level, then sift the former last entry up from
+            // there: it usually belongs near the bottom, so this saves the
+            // comparison against it at every level.
+            size_t n = static_cast<size_t>(count);
+            size_t hole = 0;
+            while (true) {
+                size_t firstChild = hole * Arity + 1;
+                if (firstChild >= n) break;
+                size_t lastChild = firstChild + Arity < n ? firstChild + Arity : n;
+                size_t best = firstChild;
+                for (size_t c = firstChild + 1; c < lastChild; c++) {
+                    if (compare(entries[c].value, entries[best].value)) best = c;
+                }
+                entries[hole] = std::move(entries[best]);
+                positions[entries[hole].handle] = hole;
+                hole = best;
+            }
+            entries[hole] = std::move(entries[count]);
+            siftUp(hole);
+            EntryTraits::destroy(alloc, &entries[count]);
+        } else {
+            EntryTraits::destroy(alloc, &entries[0]);
+        }
+        return value;
+    }
+    
+    /**
+     * Try pop: Move the first element into out; returns false if empty
+     */
+    bool try_pop(T& out) {
+        if (isEmpty()) [[unlikely]] {
+            return false;
+        }
+        out = pop();
+        return true;
+    }
+    
+    /**
+     * Value currently stored for a handle
+     */
+    const T& value(Handle h) const {
+        return entries[checkedPosition(h)].value;
+    }
+    
+    /**
+     * Decrease key: Give the element a value that comes out earlier
+     * Time Complexity: O(log_d n)
+     */
+    void decrease_key(Handle h, T newValue) {
+        size_t i = checkedPosition(h);
+        if (compare(entries[i].value, newValue)) {
+            throw runtime_error("DaryHeap: decrease_key would move the element later");
+        }
+        entries[i].value = std::move(newValue);
+        siftUp(i);
+    }
+    
+    /**
+     * Update: Give the element any new value and restore heap order
+     * Time Complexity: O(d log_d n)
+     */
+    void update(Handle h, T newValue) {
+        size_t i = checkedPosition(h);
+        bool earlier = compare(newValue, entries[i].value);
+        entries[i].value = std::move(newValue);
+        if (earlier) {
+            siftUp(i);
+        } else {
+            siftDown(i);
+        }
+    }
+    
+    /**
+     * Check if heap is empty
+     */
+    bool isEmpty() const {
+        return count == 0;
+    }
+    
+    /**
+     * Get current size of heap
+     */
+    int size() const {
+        return count;
+    }
+};
+
+/**
+ * Monotonic queue for sliding-window minimum/maximum
+ * Holds the window's elements in arrival order but only keeps those that
+ * could still become the best one: pushing a value discards every older
+ * value it beats, so the front is always the window's best. Compare(a, b)
+ * == true means a is better (less<T>: minimum, greater<T>: maximum).
+ * push() and pop() are O(1) amortized; best() is O(1).
+ * Storage is a circular array using Alloc and the Growth policies.
+ */
+template <typename T, typename Compare = less<T>,
+          typename Alloc = allocator<T>, typename Growth = DoublingGrowth>
+class MonotonicQueue {
+private:
+    struct Entry {
+        T value;
+        uint64_t sequence;   // Arrival number, identifies the element
+    };
+    
+    using EntryAlloc = typename allocator_traits<Alloc>::template rebind_alloc<Entry>;
+    using EntryTraits = allocator_traits<EntryAlloc>;
+    
+    Entry* ring;
+    int capacity;
+    int frontIndex;      // Position of the oldest kept entry
+    int kept;            // Number of kept entries
+    uint64_t pushed;     // Logical elements pushed so far
+    uint64_t popped;     // Logical elements popped so far
+    EntryAlloc alloc;
+    Compare compare;
+    
+    int slotIndex(int offset) const {
+        int i = frontIndex + offset;
+        return i >= capacity ? i - capacity : i;
+    }
+    
+    void grow() {
+        int newCapacity = Growth::grow(capacity, kept + 1);
+        Entry* newRing = EntryTraits::allocate(alloc, newCapacity);
+        // Copy when the move may throw; old entries die only after success
+        int built = 0;
+        try {
+            for (; built < kept; built++) {
+                EntryTraits::construct(alloc, &newRing[built], move_if_noexcept(ring[slotIndex(built)]));
+            }
+        } catch (...) {
+            for (int k = 0; k < built; k++) {
+                EntryTraits::destroy(alloc, &newRing[k]);
+            }
+            EntryTraits::deallocate(alloc, newRing, newCapacity);
+            throw;
+        }
+        for (int k = 0; k < kept; k++) {
+            EntryTraits::destroy(alloc, &ring[slotIndex(k)]);
+        }
+        if (ring != nullptr) EntryTraits::deallocate(alloc, ring, capacity);
+        ring = newRing;
+        capacity = newCapacity;
+        frontIndex = 0;
+    }
+    
+public:
+    explicit MonotonicQueue(int initialCapacity = 16, const Compare& cmp = Compare(),
+                            const Alloc& allocator = Alloc())
+        : ring(nullptr), capacity(0), frontIndex(0), kept(0), pushed(0), popped(0),
+          alloc(allocator), compare(cmp) {
+        if (initialCapacity > 0) {
+            ring = EntryTraits::allocate(alloc, initialCapacity);
+            capacity = initialCapacity;
+        }
+    }
+    
+    MonotonicQueue(const MonotonicQueue&) = delete;
+    MonotonicQueue& operator=(const MonotonicQueue&) = delete;
+    
+    ~MonotonicQueue() {
+        for (int k = 0; k < kept; k++) {
+            EntryTraits::destroy(alloc, &ring[slotIndex(k)]);
+        }
+        if (ring != nullptr) EntryTraits::deallocate(alloc, ring, capacity);
+    }
+    
+    /**
+     * Push: Add the newest element to the window
+     * Time Complexity: O(1) amortized
+     */
+    void push(T value) {
+        // Drop kept values the new one beats (or ties): they can never be best
+        while (kept > 0 && !compare(ring[slotIndex(kept - 1)].value, value)) {
+            EntryTraits::destroy(alloc, &ring[slotIndex(kept - 1)]);
+            kept--;
+        }
+        if (kept == capacity) {
+            grow();
+        }
+        EntryTraits::construct(alloc, &ring[slotIndex(kept)], Entry{std::move(value), pushed});
+        kept++;
+        pushed++;
+    }
+    
+    /**
+     * Pop: Remove the oldest element from the window
+     * Time Complexity: O(1)
+     */
+    void pop() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot pop from empty window");
+        }
+        if (ring[frontIndex].sequence == popped) {
+            EntryTraits::destroy(alloc, &ring[frontIndex]);
+            frontIndex = slotIndex(1);
+            kept--;
+        }
+        popped++;
+    }
+    
+    /**
+     * Best: Minimum (or maximum) of the elements in the window
+     * Time Complexity: O(1)
+     */
+    const T& best() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access best");
+        }
+        return ring[frontIndex].value;
+    }
+    
+    /**
+     * Check if window is empty
+     */
+    bool isEmpty() const {
+        return pushed == popped;
+    }
+    
+    /**
+     * Get number of elements in the window (including discarded ones)
+     */
+    int size() const {
+        return static_cast<int>(pushed - popped);
+    }
+};
+
+// ============================================================================
+// STATIC STACK AND QUEUE (fixed capacity, constexpr, never allocate)
+// ============================================================================
+
+/**
+ * Smallest unsigned type that can count to N
+ * Keeps StaticStack<char, 64> at 65 bytes instead of 72.
+ */
+template <size_t N>
+using StaticIndex = typename conditional<
+    N <= UINT8_MAX, uint8_t,
+    typename conditional<N <= UINT16_MAX, uint16_t,
+                         typename conditional<N <= UINT32_MAX, uint32_t, size_t>::type>::type>::type;
+
+/**
+ * Fixed-capacity Stack on std::array, usable in constant expressions
+ * No heap, no I/O and no tracing, so every operation is constexpr and the
+ * whole object can live on the stack or in read-only data. Overflow and
+ * underflow throw; in a constant expression that is a compile error.
+ * try_push/try_pop report failure instead, and the _unchecked forms only
+ * assert. T must be default-constructible (std::array holds N of them).
+ */
+template <typename T, size_t N>
+class StaticStack {
+    static_assert(N > 0, "StaticStack needs a capacity of at least one");
+    
+private:
+    array<T, N> slots{};
+    StaticIndex<N> count = 0;
+    
+public:
+    constexpr StaticStack() = default;
+    
+    /**
+     * Push: Add element to top of stack
+     * Time Complexity: O(1)
+     */
+    constexpr void push(const T& value) {
+        if (isFull()) [[unlikely]] {
+            throw runtime_error("Stack Overflow: StaticStack is full");
+        }
+        slots[count++] = value;
+    }
+    
+    constexpr void push(T&& value) {
+        if (isFull()) [[unlikely]] {
+            throw runtime_error("Stack Overflow: StaticStack is full");
+        }
+        slots[count++] = std::move(value);
+    }
+    
+    /**
+     * Try push: Add element if there is room; returns false when full
+     */
+    constexpr bool try_push(T value) {
+        if (isFull()) [[unlikely]] {
+            return false;
+        }
+        slots[count++] = std::move(value);
+        return true;
+    }
+    
+    /**
+     * Push unchecked: Precondition !isFull() (assert only)
+     */
+    constexpr void push_unchecked(T value) {
+        assert(!isFull());
+        slots[count++] = std::move(value);
+    }
+    
+    /**
+     * Pop: Remove and return top element
+     * Time Complexity: O(1)
+     */
+    constexpr T pop() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Stack Underflow: Cannot pop from empty stack");
+        }
+        return std::move(slots[--count]);
+    }
+    
+    /**
+     * Try pop: Move top element into out; returns false if empty
+     */
+    constexpr bool try_pop(T& out) {
+        if (isEmpty()) [[unlikely]] {
+            return false;
+        }
+        out = std::move(slots[--count]);
+        return true;
+    }
+    
+    /**
+     * Pop unchecked: Precondition !isEmpty() (assert only)
+     */
+    constexpr T pop_unchecked() {
+        assert(!isEmpty());
+        return std::move(slots[--count]);
+    }
+    
+    /**
+     * Peek: View top element without removing
+     */
+    constexpr const T& peek() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Stack is empty: Cannot peek");
+        }
+        return slots[count - 1];
+    }
+    
+    constexpr bool isEmpty() const {
+        return count == 0;
+    }
+    
+    constexpr bool isFull() const {
+        return count == N;
+    }
+    
+    constexpr int size() const {
+        return static_cast<int>(count);
+    }
+    
+    static constexpr int getCapacity() {
+        return static_cast<int>(N);
+    }
+    
+    /**
+     * Clear: Forget every element (slots keep their last values)
+     */
+    constexpr void clear() {
+        count = 0;
+    }
+};
+
+/**
+ * Fixed-capacity FIFO on std::array, usable in constant expressions
+ * A circular buffer with a head index and a count; wrap-around is a
+ * compare and reset, so any N works (not only powers of two).
+ * Same error conventions as StaticStack.
+ */
+template <typename T, size_t N>
+class StaticQueue {
+    static_assert(N > 0, "StaticQueue needs a capacity of at least one");
+    
+private:
+    array<T, N> slots{};
+    StaticIndex<N> head = 0;    // Index of front element
+    StaticIndex<N> count = 0;
+    
+    constexpr size_t rearIndex() const {
+        size_t i = static_cast<size_t>(head) + count;
+        return i >= N ? i - N : i;
+    }
+    
+    constexpr T takeFront() {
+        T value = std::move(slots[head]);
+        head = static_cast<StaticIndex<N>>(head + 1 == N ? 0 : head + 1);
+        count--;
+        return value;
+    }
+    
+public:
+    constexpr StaticQueue() = default;
+    
+    /**
+     * Enqueue: Add element to rear of queue
+     * Time Complexity: O(1)
+     */
+    constexpr void enqueue(T value) {
+        if (isFull()) [[unlikely]] {
+            throw runtime_error("Queue Overflow: StaticQueue is full");
+        }
+        slots[rearIndex()] = std::move(value);
+        count++;
+    }
+    
+    /**
+     * Try enqueue: Add element if there is room; returns false when full
+     */
+    constexpr bool try_enqueue(T value) {
+        if (isFull()) [[unlikely]] {
+            return false;
+        }
+        slots[rearIndex()] = std::move(value);
+        count++;
+        return true;
+    }
+    
+    /**
+     * Dequeue: Remove and return front element
+     * Time Complexity: O(1)
+     */
+    constexpr T dequeue() {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+        }
+        return takeFront();
+    }
+    
+    /**
+     * Try dequeue: Move front element into out; returns false if empty
+     */
+    constexpr bool try_dequeue(T& out) {
+        if (isEmpty()) [[unlikely]] {
+            return false;
+        }
+        out = takeFront();
+        return true;
+    }
+    
+    /**
+     * Dequeue unchecked: Precondition !isEmpty() (assert only)
+     */
+    constexpr T dequeue_unchecked() {
+        assert(!isEmpty());
+        return takeFront();
+    }
+    
+    /**
+     * Front: View front element without removing
+     */
+    constexpr const T& front() const {
+        if (isEmpty()) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access front");
+        }
+        return slots[head];
+    }
+    
+    constexpr bool isEmpty() const {
+        return count == 0;
+    }
+    
+    constexpr bool isFull() const {
+        return count == N;
+    }
+    
+    constexpr int size() const {
+        return static_cast<int>(count);
+    }
+    
+    static constexpr int getCapacity() {
+        return static_cast<int>(N);
+    }
+    
+    constexpr void clear() {
+        head = 0;
+        count = 0;
+    }
+};
+
+/**
+ * Evaluate a postfix expression of single-digit operands and + - * /,
+ * separated by optional spaces, e.g. "2 3 4 * +" -> 14
+ * Usable at compile time: a malformed expression fails the build.
+ */
+constexpr int evaluatePostfix(string_view expression) {
+    StaticStack<int, 32> operands;
+    for (char c : expression) {
+        if (c == ' ') continue;
+        if (c >= '0' && c <= '9') {
+            operands.push(c - '0');
+            continue;
+        }
+        int right = operands.pop();
+        int left = operands.pop();
+        switch (c) {
+            case '+': operands.push(left + right); break;
+            case '-': operands.push(left - right); break;
+            case '*': operands.push(left * right); break;
+            case '/':
+                if (right == 0) throw runtime_error("Postfix: division by zero");
+                operands.push(left / right);
+                break;
+            default: throw runtime_error("Postfix: unknown operator");
+        }
+    }
+    int result = operands.pop();
+    if (!operands.isEmpty()) throw runtime_error("Postfix: too many operands");
+    return result;
+}
+
+/**
+ * Josephus problem with a queue: n people in a circle, every k-th leaves;
+ * returns the survivor's position (1-based). A compile-time table:
+ *   constexpr auto table = josephusTable<8>(3);
+ */
+constexpr int josephusSurvivor(int n, int k) {
+    StaticQueue<int, 64> circle;
+    for (int i = 1; i <= n; i++) circle.enqueue(i);
+    while (circle.size() > 1) {
+        for (int skip = 1; skip < k; skip++) circle.enqueue(circle.dequeue());
+        circle.dequeue();
+    }
+    return circle.front();
+}
+
+template <size_t MaxPeople>
+constexpr array<int, MaxPeople + 1> josephusTable(int k) {
+    array<int, MaxPeople + 1> table{};
+    for (size_t n = 1; n <= MaxPeople; n++) {
+        table[n] = josephusSurvivor(static_cast<int>(n), k);
+    }
+    return table;
+}
+
+// Both containers are exercised by the compiler itself
+static_assert(evaluatePostfix("2 3 4 * +") == 14, "postfix evaluation");
+static_assert(evaluatePostfix("9 3 / 2 -") == 1, "postfix evaluation");
+static_assert(josephusSurvivor(7, 3) == 4, "Josephus via StaticQueue");
+static_assert(sizeof(StaticStack<char, 64>) == 65, "StaticIndex keeps the counter small");
+
+// ============================================================================
+// EXPRESSION EVALUATOR (infix compiled once, evaluated over columnar batches)
+// ============================================================================
+
+/**
+ * Vector lanes for the batch evaluator: one operand stack per lane
+ * Every ISA provides the same static vocabulary on a register of WIDTH
+ * doubles; min/max pick the first operand unless the second is strictly
+ * smaller/larger, matching the scalar path bit for bit.
+ */
+#if defined(__AVX512F__)
+struct ExprLanes {
+    using Reg = __m512d;
+    static constexpr int WIDTH = 8;
+    static constexpr const char* NAME = "AVX-512";
+    static Reg load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, Reg v) { _mm512_storeu_pd(p, v); }
+    static Reg broadcast(double v) { return _mm512_set1_pd(v); }
+    static Reg add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+    static Reg div(Reg a, Reg b) { return _mm512_div_pd(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(b, a, _CMP_LT_OQ), a, b); }
+    static Reg max(Reg a, Reg b) { return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(b, a, _CMP_GT_OQ), a, b); }
+};
+#elif defined(__AVX2__)
+struct ExprLanes {
+    using Reg = __m256d;
+    static constexpr int WIDTH = 4;
+    static constexpr const char* NAME = "AVX2";
+    static Reg load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, Reg v) { _mm256_storeu_pd(p, v); }
+    static Reg broadcast(double v) { return _mm256_set1_pd(v); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+    static Reg div(Reg a, Reg b) { return _mm256_div_pd(a, b); }
+    static Reg min(Reg a, Reg b) { return _mm256_blendv_pd(a, b, _mm256_cmp_pd(b, a, _CMP_LT_OQ)); }
+    static Reg max(Reg a, Reg b) { return _mm256_blendv_pd(a, b, _mm256_cmp_pd(b, a, _CMP_GT_OQ)); }
+};
+#elif defined(__SSE2__)
+struct ExprLanes {
+    using Reg = __m128d;
+    static constexpr int WIDTH = 2;
+    static constexpr const char* NAME = "SSE2";
+    static Reg load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, Reg v) { _mm_storeu_pd(p, v); }
+    static Reg broadcast(double v) { return _mm_set1_pd(v); }
+    static Reg add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm_sub_pd(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm_mul_pd(a, b); }
+    static Reg div(Reg a, Reg b) { return _mm_div_pd(a, b); }
+    static Reg min(Reg a, Reg b) {
+        Reg take = _mm_cmplt_pd(b, a);
+        return _mm_or_pd(_mm_and_pd(take, b), _mm_andnot_pd(take, a));
+    }
+    static Reg max(Reg a, Reg b) {
+        Reg take = _mm_cmpgt_pd(b, a);
+        return _mm_or_pd(_mm_and_pd(take, b), _mm_andnot_pd(take, a));
+    }
+};
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct ExprLanes {
+    using Reg = float64x2_t;
+    static constexpr int WIDTH = 2;
+    static constexpr const char* NAME = "NEON";
+    static Reg load(const double* p) { return vld1q_f64(p); }
+    static void store(double* p, Reg v) { vst1q_f64(p, v); }
+    static Reg broadcast(double v) { return vdupq_n_f64(v); }
+    static Reg add(Reg a, Reg b) { return vaddq_f64(a, b); }
+    static Reg sub(Reg a, Reg b) { return vsubq_f64(a, b); }
+    static Reg mul(Reg a, Reg b) { return vmulq_f64(a, b); }
+    static Reg div(Reg a, Reg b) { return vdivq_f64(a, b); }
+    static Reg min(Reg a, Reg b) { return vbslq_f64(vcltq_f64(b, a), b, a); }
+    static Reg max(Reg a, Reg b) { return vbslq_f64(vcgtq_f64(b, a), b, a); }
+};
+#else
+struct ExprLanes {
+    using Reg = double;
+    static constexpr int WIDTH = 1;
+    static constexpr const char* NAME = "scalar";
+    static Reg load(const double* p) { return *p; }
+    static void store(double* p, Reg v) { *p = v; }
+    static Reg broadcast(double v) { return v; }
+    static Reg add(Reg a, Reg b) { return a + b; }
+    static Reg sub(Reg a, Reg b) { return a - b; }
+    static Reg mul(Reg a, Reg b) { return a * b; }
+    static Reg div(Reg a, Reg b) { return a / b; }
+    static Reg min(Reg a, Reg b) { return b < a ? b : a; }
+    static Reg max(Reg a, Reg b) { return b > a ? b : a; }
+};
+#endif
+
+/**
+ * Postfix instruction set (LeftParen only appears while compiling)
+ */
+enum class ExprOp : uint8_t {
+    Constant, Column, Add, Subtract, Multiply, Divide, Negate, Min, Max, LeftParen
+};
+
+/**
+ * One postfix instruction; slot is the operand-stack depth it writes
+ * (operands of a binary op are slot and slot + 1), fixed at compile time
+ */
+struct ExprInstruction {
+    ExprOp op;
+    int slot;
+    int column;
+    double constant;
+};
+
+/**
+ * Arithmetic expression over named double columns, compiled once
+ *   CompiledExpression expr("price * (1 + tax) - min(discount, cap)",
+ *                           {"price", "tax", "discount", "cap"});
+ * Grammar: numbers, column names, + - * /, unary minus, parentheses and
+ * the two-argument functions min() and max(). Division follows IEEE 754
+ * (x / 0 is inf or nan) in both evaluation paths, so a batch never stops
+ * half way through.
+ *
+ * The constructor converts infix to postfix with the shunting-yard
+ * algorithm on a SmallStack and assigns every instruction its stack slot.
+ * evaluate() interprets one row on a SmallStack; evaluateBatch() runs the
+ * program once per block of BLOCK_ROWS rows, each instruction sweeping
+ * one slot of all the rows' operand stacks with vector loads and stores.
+ * Compiled expressions are immutable and safe to evaluate concurrently.
+ */
+class CompiledExpression {
+public:
+    static constexpr int BLOCK_ROWS = 64;
+    
+private:
+    /**
+     * Entry on the shunting-yard operator stack; a LeftParen records
+     * whether it opened a function's argument list
+     */
+    struct PendingOp {
+        ExprOp op;
+        bool functionCall;
+    };
+    
+    vector<ExprInstruction> program;
+    int maxDepth;
+    int columnCount;
+    
+    static int precedence(ExprOp op) {
+        switch (op) {
+            case ExprOp::Add:
+            case ExprOp::Subtract: return 1;
+            case ExprOp::Multiply:
+            case ExprOp::Divide: return 2;
+            case ExprOp::Negate: return 3;
+            default: return 0;
+        }
+    }
+    
+    static bool isIdentifierChar(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+    
+    void emit(ExprOp op, int column = -1, double constant = 0.0) {
+        program.push_back({op, 0, column, constant});
+    }
+    
+    /**
+     * Pop operators into the program until a LeftParen (left on the
+     * stack) or until the stack is empty
+     */
+    void flushUntilParen(SmallStack<PendingOp, 32, NoTrace>& ops) {
+        while (!ops.isEmpty() && ops.top().op != ExprOp::LeftParen) {
+            emit(ops.pop().op);
+        }
+    }
+    
+    void parse(string_view text, const vector<string>& columns) {
+        SmallStack<PendingOp, 32, NoTrace> ops;
+        bool expectOperand = true;
+        size_t i = 0;
+        while (i < text.size()) {
+            char c = text[i];
+            if (c == ' ' || c == '\t') {
+                i++;
+                continue;
+            }
+            if ((c >= '0' && c <= '9') || c == '.') {
+                if (!expectOperand) throw runtime_error("Expression: expected an operator before a number");
+                double value = 0.0;
+                auto [end, error] = from_chars(text.data() + i, text.data() + text.size(), value);
+                if (error != errc()) throw runtime_error("Expression: malformed number");
+                i = static_cast<size_t>(end - text.data());
+                emit(ExprOp::Constant, -1, value);
+                expectOperand = false;
+                continue;
+            }
+            if (isIdentifierChar(c)) {
+                if (!expectOperand) throw runtime_error("Expression: expected an operator before a name");
+                size_t start = i;
+                while (i < text.size() && isIdentifierChar(text[i])) i++;
+                string_view name = text.substr(start, i - start);
+                if (name == "min" || name == "max") {
+                    while (i < text.size() && text[i] == ' ') i++;
+                    if (i == text.size() || text[i] != '(') {
+                        throw runtime_error("Expression: " + string(name) + " must be called");
+                    }
+                    ops.push({name == "min" ? ExprOp::Min : ExprOp::Max, false});
+                    ops.push({ExprOp::LeftParen, true});
+                    i++;
+                    continue;
+                }
+                auto it = std::find(columns.begin(), columns.end(), name);
+                if (it == columns.end()) throw runtime_error("Expression: unknown column '" + string(name) + "'");
+                emit(ExprOp::Column, static_cast<int>(it - columns.begin()));
+                expectOperand = false;
+                continue;
+            }
+            i++;
+            switch (c) {
+                case '(':
+                    if (!expectOperand) throw runtime_error("Expression: expected an operator before '('");
+                    ops.push({ExprOp::LeftParen, false});
+                    break;
+                case ')':
+                case ',': {
+                    if (expectOperand) throw runtime_error("Expression: missing operand");
+                    flushUntilParen(ops);
+                    if (ops.isEmpty()) throw runtime_error("Expression: unbalanced ')' or ','");
+                    if (c == ',') {
+                        if (!ops.top().functionCall) throw runtime_error("Expression: ',' outside a call");
+                        expectOperand = true;
+                    } else {
+                        bool call = ops.pop().functionCall;
+                        if (call) emit(ops.pop().op);
+                    }
+                    break;
+                }
+                case '+':
+                case '-':
+                case '*':
+                case '/': {
+                    ExprOp op;
+                    if (expectOperand) {
+                        if (c != '-') throw runtime_error("Expression: missing operand");
+                        op = ExprOp::Negate;  // unary, right-associative: nothing to pop
+                    } else {
+                        op = c == '+' ? ExprOp::Add : c == '-' ? ExprOp::Subtract
+                           : c == '*' ? ExprOp::Multiply : ExprOp::Divide;
+                        while (!ops.isEmpty() && precedence(ops.top().op) >= precedence(op)) {
+                            emit(ops.pop().op);
+                        }
+                    }
+                    ops.push({op, false});
+                    expectOperand = true;
+                    break;
+                }
+                default:
+                    throw runtime_error(string("Expression: unexpected character '") + c + "'");
+            }
+        }
+        if (expectOperand) throw runtime_error("Expression: missing operand");
+        flushUntilParen(ops);
+        if (!ops.isEmpty()) throw runtime_error("Expression: unbalanced '('");
+    }
+    
+    /**
+     * Assign stack slots by simulating the operand depth; rejects
+     * programs that underflow or leave more than one result
+     */
+    void assignSlots() {
+        int depth = 0;
+        maxDepth = 0;
+        for (ExprInstruction& in : program) {
+            switch (in.op) {
+                case ExprOp::Constant:
+                case ExprOp::Column:
+                    in.slot = depth++;
+                    break;
+                case ExprOp::Negate:
+                    in.slot = depth - 1;
+                    break;
+                default:
+                    if (depth < 2) throw runtime_error("Expression: missing operand");
+                    in.slot = --depth - 1;
+                    break;
+            }
+            maxDepth = std::max(maxDepth, depth);
+        }
+        if (depth != 1) throw runtime_error("Expression: too many operands");
+    }
+    
+    static double apply(ExprOp op, double left, double right) {
+        switch (op) {
+            case ExprOp::Add: return left + right;
+            case ExprOp::Subtract: return left - right;
+            case ExprOp::Multiply: return left * right;
+            case ExprOp::Divide: return left / right;
+            case ExprOp::Min: return right < left ? right : left;
+            default: return right > left ? right : left;
+        }
+    }
+    
+    /**
+     * Run the program over one block: rows [0, n) of the columns land in
+     * lanes [0, n); a short last block is padded with zeros
+     * registers holds maxDepth slots of BLOCK_ROWS lanes each
+     */
+    void evaluateBlock(const double* const* columns, size_t first, int n, double* registers,
+                       double* out) const {
+        using L = ExprLanes;
+        static_assert(BLOCK_ROWS % L::WIDTH == 0, "block must be whole vectors");
+        for (const ExprInstruction& in : program) {
+            double* dst = registers + static_cast<size_t>(in.slot) * BLOCK_ROWS;
+            const double* rhs = dst + BLOCK_ROWS;
+            switch (in.op) {
+                case ExprOp::Constant: {
+                    typename L::Reg v = L::broadcast(in.constant);
+                    for (int lane = 0; lane < BLOCK_ROWS; lane += L::WIDTH) L::store(dst + lane, v);
+                    break;
+                }
+                case ExprOp::Column: {
+                    const double* src = columns[in.column] + first;
+                    if (n == BLOCK_ROWS) [[likely]] {
+                        for (int lane = 0; lane < BLOCK_ROWS; lane += L::WIDTH) {
+                            L::store(dst + lane, L::load(src + lane));
+                        }
+                    } else {
+                        std::copy(src, src + n, dst);
+                        std::fill(dst + n, dst + BLOCK_ROWS, 0.0);
+                    }
+                    break;
+                }
+                case ExprOp::Negate: {
+                    typename L::Reg minusOne = L::broadcast(-1.0);
+                    for (int lane = 0; lane < BLOCK_ROWS; lane += L::WIDTH) {
+                        L::store(dst + lane, L::mul(L::load(dst + lane), minusOne));
+                    }
+                    break;
+                }
+#define STACK_QUEUE_EXPR_BINARY(OP, FN)                                                   \
+                case ExprOp::OP:                                                          \
+                    for (int lane = 0; lane < BLOCK_ROWS; lane += L::WIDTH) {             \
+                        L::store(dst + lane, L::FN(L::load(dst + lane), L::load(rhs + lane))); \
+                    }                                                                     \
+                    break;
+                STACK_QUEUE_EXPR_BINARY(Add, add)
+                STACK_QUEUE_EXPR_BINARY(Subtract, sub)
+                STACK_QUEUE_EXPR_BINARY(Multiply, mul)
+                STACK_QUEUE_EXPR_BINARY(Divide, div)
+                STACK_QUEUE_EXPR_BINARY(Min, min)
+                STACK_QUEUE_EXPR_BINARY(Max, max)
+#undef STACK_QUEUE_EXPR_BINARY
+                case ExprOp::LeftParen:
+                    break;
+            }
+        }
+        std::copy(registers, registers + n, out + first);
+    }
+    
+public:
+    /**
+     * Constructor: Compile infix text against the given column names
+     * Throws runtime_error describing the first syntax error
+     * Time Complexity: O(length of text * number of columns)
+     */
+    CompiledExpression(string_view text, const vector<string>& columns)
+        : maxDepth(0), columnCount(static_cast<int>(columns.size())) {
+        parse(text, columns);
+        assignSlots();
+    }
+    
+    /**
+     * Evaluate one row: row[c] is the value of column c
+     * Time Complexity: O(program length)
+     */
+    double evaluate(const double* row) const {
+        SmallStack<double, 32, NoTrace> operands;
+        for (const ExprInstruction& in : program) {
+            switch (in.op) {
+                case ExprOp::Constant: operands.push(in.constant); break;
+                case ExprOp::Column: operands.push(row[in.column]); break;
+                case ExprOp::Negate: operands.push(-operands.pop()); break;
+                default: {
+                    double right = operands.pop();
+                    double left = operands.pop();
+                    operands.push(apply(in.op, left, right));
+                    break;
+                }
+            }
+        }
+        return operands.pop();
+    }
+    
+    /**
+     * Evaluate batch: out[r] = value for row r, where columns[c][r] is
+     * column c of row r (one contiguous array per column)
+     * Time Complexity: O(rows * program length / vector width)
+     */
+    void evaluateBatch(const double* const* columns, size_t rows, double* out) const {
+        vector<double> registers(static_cast<size_t>(maxDepth) * BLOCK_ROWS);
+        for (size_t first = 0; first < rows; first += BLOCK_ROWS) {
+            int n = static_cast<int>(std::min<size_t>(BLOCK_ROWS, rows - first));
+            evaluateBlock(columns, first, n, registers.data(), out);
+        }
+    }
+    
+    void evaluateBatch(const vector<const double*>& columns, size_t rows, double* out) const {
+        if (static_cast<int>(columns.size()) != columnCount) [[unlikely]] {
+            throw runtime_error("Expression: batch has the wrong number of columns");
+        }
+        evaluateBatch(columns.data(), rows, out);
+    }
+    
+    /**
+     * Postfix: The compiled program as text, e.g. "price 1 tax + *"
+     */
+    string toPostfix(const vector<string>& columns) const {
+        static const char* const SYMBOLS[] = {"", "", "+", "-", "*", "/", "neg", "min", "max", "("};
+        ostringstream text;
+        for (size_t i = 0; i < program.size(); i++) {
+            if (i > 0) text << ' ';
+            const ExprInstruction& in = program[i];
+            if (in.op == ExprOp::Constant) {
+                text << in.constant;
+            } else if (in.op == ExprOp::Column) {
+                text << columns[in.column];
+            } else {
+                text << SYMBOLS[static_cast<int>(in.op)];
+            }
+        }
+        return text.str();
+    }
+    
+    int length() const {
+        return static_cast<int>(program.size());
+    }
+    
+    int stackDepth() const {
+        return maxDepth;
+    }
+};
+
+/**
+ * Cache of compiled expressions over one column schema
+ * get() parses each distinct text once; later calls return the same
+ * program. References stay valid for the cache's lifetime. Thread-safe.
+ */
+class ExpressionCache {
+private:
+    vector<string> columns;
+    mutable mutex lock;
+    unordered_map<string, unique_ptr<const CompiledExpression>> programs;
+    
+public:
+    explicit ExpressionCache(vector<string> columnNames) : columns(std::move(columnNames)) {}
+    
+    ExpressionCache(const ExpressionCache&) = delete;
+    ExpressionCache& operator=(const ExpressionCache&) = delete;
+    
+    /**
+     * Get: Compiled program for text, compiling it on first use
+     * Time Complexity: O(length of text) when cached
+     */
+    const CompiledExpression& get(string_view text) {
+        lock_guard<mutex> guard(lock);
+        auto it = programs.find(string(text));
+        if (it == programs.end()) {
+            it = programs.emplace(string(text), make_unique<const CompiledExpression>(text, columns)).first;
+        }
+        return *it->second;
+    }
+    
+    const vector<string>& columnNames() const {
+        return columns;
+    }
+    
+    int size() const {
+        lock_guard<mutex> guard(lock);
+        return static_cast<int>(programs.size());
+    }
+};
+
+// ============================================================================
+// SPSC QUEUE IMPLEMENTATION (lock-free, one producer and one consumer)
+// ============================================================================
+
+/**
+ * Bounded single-producer/single-consumer queue on a circular array
+ * Exactly one thread may call the enqueue side and one the dequeue side.
+ * No locks and no system calls: the head and tail indices are published
+ * with release stores and observed with acquire loads. Each side also keeps
+ * a private copy of the other side's index and only re-reads the shared one
+ * when the copy says the queue looks full (or empty).
+ */
+template <typename T>
+class SpscQueue {
+private:
+    // Consumer-owned line
+    alignas(CACHE_LINE_SIZE) atomic<size_t> head;   // Next slot to dequeue
+    size_t cachedTail;                              // Consumer's view of tail
+    
+    // Producer-owned line
+    alignas(CACHE_LINE_SIZE) atomic<size_t> tail;   // Next slot to fill
+    size_t cachedHead;                              // Producer's view of head
+    
+    // Read-only after construction
+    alignas(CACHE_LINE_SIZE) T* buffer;
+    size_t capacity;     // Always a power of two
+    size_t mask;         // capacity - 1
+    int numaNode;        // Node the buffer was placed on (-1: any)
+    
+public:
+    /**
+     * Constructor: Allocate room for capacity elements (rounded up to 2^k)
+     * numaNode >= 0 places the buffer on that node's memory; pass the
+     * consumer's node, since it reads every element
+     */
+    SpscQueue(size_t requestedCapacity = 1024, int node = -1)
+        : head(0), cachedTail(0), tail(0), cachedHead(0), numaNode(node) {
+        capacity = 1;
+        while (capacity < requestedCapacity) capacity <<= 1;
+        mask = capacity - 1;
+        buffer = static_cast<T*>(numaAllocate(capacity * sizeof(T), numaNode));
+    }
+    
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+    
+    /**
+     * Destructor: Destroy elements still in the queue
+     * Both threads must have stopped using the queue.
+     */
+    ~SpscQueue() {
+        size_t h = head.load(memory_order_relaxed);
+        size_t t = tail.load(memory_order_relaxed);
+        for (; h != t; h++) {
+            buffer[h & mask].~T();
+        }
+        numaFree(buffer, capacity * sizeof(T), numaNode);
+    }
+    
+    /**
+     * Try emplace (producer): Construct element at rear if there is room
+     * Returns false instead of blocking when the queue is full
+     * Time Complexity: O(1)
+     */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - cachedHead == capacity) {
+            cachedHead = head.load(memory_order_acquire);
+            if (t - cachedHead == capacity) {
+                return false;
+            }
+        }
+        new (&buffer[t & mask]) T(std::forward<Args>(args)...);
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+    
+    bool try_enqueue(const T& value) {
+        return try_emplace(value);
+    }
+    
+    bool try_enqueue(T&& value) {
+        return try_emplace(std::move(value));
+    }
+    
+    /**
+     * Try dequeue (consumer): Move front element into out if there is one
+     * Returns false instead of blocking when the queue is empty
+     * Time Complexity: O(1)
+     */
+    bool try_dequeue(T& out) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(memory_order_acquire);
+            if (h == cachedTail) {
+                return false;
+            }
+        }
+        T& slot = buffer[h & mask];
+        out = std::move(slot);
+        slot.~T();
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+    
+    /**
+     * Try enqueue bulk (producer): Copy up to count elements from first
+     * Publishes the whole batch with a single release store
+     * Returns the number of elements actually enqueued; if copying one
+     * throws, nothing is enqueued
+     */
+    template <typename InputIt>
+    size_t try_enqueue_bulk(InputIt first, size_t count) {
+        size_t t = tail.load(memory_order_relaxed);
+        size_t room = capacity - (t - cachedHead);
+        if (room < count) {
+            cachedHead = head.load(memory_order_acquire);
+            room = capacity - (t - cachedHead);
+        }
+        size_t n = count < room ? count : room;
+        size_t i = 0;
+        try {
+            for (; i < n; i++, ++first) {
+                new (&buffer[(t + i) & mask]) T(*first);
+            }
+        } catch (...) {
+            // Nothing was published: tear down the partial batch
+            while (i > 0) {
+                i--;
+                buffer[(t + i) & mask].~T();
+            }
+            throw;
+        }
+        if (n > 0) {
+            tail.store(t + n, memory_order_release);
+        }
+        return n;
+    }
+    
+    /**
+     * Try dequeue bulk (consumer): Move up to maxCount elements to out
+     * Frees the whole batch with a single release store
+     * Returns the number of elements actually dequeued
+     */
+    template <typename OutputIt>
+    size_t try_dequeue_bulk(OutputIt out, size_t maxCount) {
+        size_t h = head.load(memory_order_relaxed);
+        size_t available = cachedTail - h;
+        if (available < maxCount) {
+            cachedTail = tail.load(memory_order_acquire);
+            available = cachedTail - h;
+        }
+        size_t n = maxCount < available ? maxCount : available;
+        for (size_t i = 0; i < n; i++, ++out) {
+            T& slot = buffer[(h + i) & mask];
+            *out = std::move(slot);
+            slot.~T();
+        }
+        if (n > 0) {
+            head.store(h + n, memory_order_release);
+        }
+        return n;
+    }
+    
+    /**
+     * Approximate number of elements (exact when called by either side
+     * while the other is idle)
+     */
+    size_t size() const {
+        size_t t = tail.load(memory_order_acquire);
+        size_t h = head.load(memory_order_acquire);
+        return t - h;
+    }
+    
+    /**
+     * Check if queue is (approximately) empty
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+    
+    /**
+     * Get the fixed capacity of the queue
+     */
+    size_t getCapacity() const {
+        return capacity;
+    }
+};
+
+// ============================================================================
+// MAPPED QUEUE IMPLEMENTATION (file-backed, shared between processes)
+// ============================================================================
+
+#if STACK_QUEUE_HAVE_MMAP
+
+/**
+ * How hard MappedQueue works to get data onto stable storage
+ * - Never: Rely on the kernel's write-back. Survives a process crash
+ *   (the page cache holds the data) but not a power loss.
+ * - SyncEachBatch: msync the touched pages after every enqueue or release
+ *   call, so a returned call is durable. A bulk call counts as one batch.
+ */
+enum class Durability {
+    Never,
+    SyncEachBatch
+};
+
+/**
+ * Bounded FIFO ring stored in a memory-mapped file
+ * Any number of processes may attach to the same file; at any moment one
+ * of them acts as the producer and one as the consumer (the same rules as
+ * SpscQueue, applied across processes). The header holds head and tail
+ * as lock-free atomics, so a crash of either side leaves the queue
+ * consistent: an element becomes visible only after it is fully written.
+ * The consumer can read elements in place (try_front/peek_contiguous)
+ * and release them afterwards, so nothing is copied out.
+ * T must be trivially copyable because it is stored as raw bytes.
+ */
+template <typename T>
+class MappedQueue {
+private:
+    static_assert(is_trivially_copyable<T>::value,
+                  "MappedQueue elements must be trivially copyable");
+    static_assert(atomic<uint64_t>::is_always_lock_free,
+                  "MappedQueue needs lock-free 64-bit atomics to share them between processes");
+    
+    static constexpr uint64_t MAGIC = 0x5155455545504d4dull;  // "MMPEUEUQ"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 4096;              // Keeps data page-aligned
+    
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t elementSize;
+        uint64_t capacity;
+        alignas(CACHE_LINE_SIZE) atomic<uint64_t> head;   // Written by consumer
+        alignas(CACHE_LINE_SIZE) atomic<uint64_t> tail;   // Written by producer
+    };
+    static_assert(sizeof(Header) <= HEADER_BYTES, "Header must fit its page");
+    
+    int fd;
+    unsigned char* base;  // Start of the mapping
+    size_t mappedBytes;
+    Header* header;
+    T* slots;
+    uint64_t capacity;
+    uint64_t mask;
+    Durability durability;
+    
+    [[noreturn]] static void fail(const string& what) {
+        throw runtime_error("MappedQueue: " + what + ": " + strerror(errno));
+    }
+    
+    /**
+     * msync the pages covering [offset, offset + bytes) of the mapping
+     */
+    void syncRange(size_t offset, size_t bytes) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t start = offset / page * page;
+        if (msync(base + start, offset + bytes - start, MS_SYNC) != 0) {
+            fail("msync");
+        }
+    }
+    
+    /**
+     * Sync slots [first, first + n) (wrapping); the header is synced by
+     * the caller once the tail that publishes them has been stored
+     */
+    void syncSlots(uint64_t first, uint64_t n) {
+        uint64_t start = first & mask;
+        uint64_t firstPart = capacity - start < n ? capacity - start : n;
+        syncRange(HEADER_BYTES + start * sizeof(T), firstPart * sizeof(T));
+        if (n > firstPart) {
+            syncRange(HEADER_BYTES, (n - firstPart) * sizeof(T));
+        }
+    }
+    
+public:
+    /**
+     * Constructor: Attach to path, creating it with room for
+     * requestedCapacity elements (rounded up to 2^k) if it does not exist
+     * An existing file keeps its own capacity; it must hold the same T.
+     */
+    MappedQueue(const string& path, size_t requestedCapacity = 4096,
+                Durability mode = Durability::Never)
+        : durability(mode) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) fail("open " + path);
+        
+        // Serialize initialization against other processes attaching now
+        if (flock(fd, LOCK_EX) != 0) {
+            close(fd);
+            fail("flock " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            fail("fstat " + path);
+        }
+        
+        bool fresh = info.st_size == 0;
+        if (fresh) {
+            capacity = 1;
+            while (capacity < requestedCapacity) capacity <<= 1;
+            mappedBytes = HEADER_BYTES + capacity * sizeof(T);
+            if (ftruncate(fd, static_cast<off_t>(mappedBytes)) != 0) {
+                close(fd);
+                fail("ftruncate " + path);
+            }
+        } else if (info.st_size < static_cast<off_t>(HEADER_BYTES)) {
+            // Too short to even hold a header; reading it would fault
+            close(fd);
+            throw runtime_error("MappedQueue: " + path + " is not a queue of this element type");
+        } else {
+            mappedBytes = static_cast<size_t>(info.st_size);
+        }
+        
+        void* p = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            fail("mmap " + path);
+        }
+        base = static_cast<unsigned char*>(p);
+        header = reinterpret_cast<Header*>(base);
+        slots = reinterpret_cast<T*>(base + HEADER_BYTES);
+        
+        if (fresh) {
+            header->magic = MAGIC;
+            header->version = VERSION;
+            header->elementSize = sizeof(T);
+            header->capacity = capacity;
+            new (&header->head) atomic<uint64_t>(0);
+            new (&header->tail) atomic<uint64_t>(0);
+            if (msync(base, HEADER_BYTES, MS_SYNC) != 0) {
+                int error = errno;
+                munmap(base, mappedBytes);
+                close(fd);
+                errno = error;
+                fail("msync " + path);
+            }
+        } else {
+            // Everything below indexes the mapping, so nothing in the file
+            // is trusted until it is consistent with the file's size
+            uint64_t stored = header->capacity;
+            uint64_t h = header->head.load(memory_order_acquire);
+            uint64_t t = header->tail.load(memory_order_acquire);
+            bool sameType = header->magic == MAGIC && header->version == VERSION &&
+                            header->elementSize == sizeof(T);
+            bool consistent = stored != 0 && (stored & (stored - 1)) == 0 &&
+                              stored <= (mappedBytes - HEADER_BYTES) / sizeof(T) &&
+                              mappedBytes == HEADER_BYTES + stored * sizeof(T) &&
+                              t - h <= stored;
+            if (!sameType || !consistent) {
+                munmap(base, mappedBytes);
+                close(fd);
+                throw runtime_error("MappedQueue: " + path +
+                                    (sameType ? " is corrupt" : " is not a queue of this element type"));
+            }
+        }
+        capacity = header->capacity;
+        mask = capacity - 1;
+        flock(fd, LOCK_UN);
+    }
+    
+    MappedQueue(const MappedQueue&) = delete;
+    MappedQueue& operator=(const MappedQueue&) = delete;
+    
+    /**
+     * Destructor: Detach (the file and its contents stay)
+     */
+    ~MappedQueue() {
+        munmap(base, mappedBytes);
+        close(fd);
+    }
+    
+    /**
+     * Try enqueue bulk (producer): Append up to n elements
+     * Returns the number appended; all of them are published at once
+     */
+    size_t try_enqueue_bulk(const T* items, size_t n) {
+        uint64_t t = header->tail.load(memory_order_relaxed);
+        uint64_t h = header->head.load(memory_order_acquire);
+        uint64_t room = capacity - (t - h);
+        uint64_t count = n < room ? n : room;
+        if (count == 0) return 0;
+        
+        uint64_t start = t & mask;
+        uint64_t firstPart = capacity - start < count ? capacity - start : count;
+        memcpy(&slots[start], items, firstPart * sizeof(T));
+        memcpy(&slots[0], items + firstPart, (count - firstPart) * sizeof(T));
+        
+        if (durability == Durability::SyncEachBatch) {
+            // Data must be durable before the tail that exposes it
+            syncSlots(t, count);
+        }
+        header->tail.store(t + count, memory_order_release);
+        if (durability == Durability::SyncEachBatch) {
+            syncRange(0, sizeof(Header));
+        }
+        return static_cast<size_t>(count);
+    }
+    
+    /**
+     * Try enqueue (producer): Append one element if there is room
+     */
+    bool try_enqueue(const T& value) {
+        return try_enqueue_bulk(&value, 1) == 1;
+    }
+    
+    /**
+     * Try front (consumer): Pointer to the front element in the mapping,
+     * or nullptr if empty; valid until release()
+     */
+    const T* try_front() const {
+        uint64_t h = header->head.load(memory_order_relaxed);
+        uint64_t t = header->tail.load(memory_order_acquire);
+        return h == t ? nullptr : &slots[h & mask];
+    }
+    
+    /**
+     * Peek contiguous (consumer): Point first at the longest run of
+     * readable elements that does not wrap, and return its length
+     */
+    size_t peek_contiguous(const T*& first) const {
+        uint64_t h = header->head.load(memory_order_relaxed);
+        uint64_t t = header->tail.load(memory_order_acquire);
+        uint64_t start = h & mask;
+        uint64_t available = t - h;
+        uint64_t run = capacity - start < available ? capacity - start : available;
+        first = &slots[start];
+        return static_cast<size_t>(run);
+    }
+    
+    /**
+     * Release (consumer): Drop n front elements that have been read
+     */
+    void release(size_t n = 1) {
+        uint64_t h = header->head.load(memory_order_relaxed);
+        uint64_t t = header->tail.load(memory_order_acquire);
+        if (n > t - h) {
+            throw runtime_error("Queue Underflow: Cannot release more than is queued");
+        }
+        header->head.store(h + n, memory_order_release);
+        if (durability == Durability::SyncEachBatch) {
+            syncRange(0, sizeof(Header));
+        }
+    }
+    
+    /**
+     * Try dequeue (consumer): Copy the front element out and release it
+     */
+    bool try_dequeue(T& out) {
+        const T* front = try_front();
+        if (front == nullptr) return false;
+        out = *front;
+        release(1);
+        return true;
+    }
+    
+    /**
+     * Flush: Force everything in the mapping to stable storage
+     */
+    void flush() {
+        if (msync(base, mappedBytes, MS_SYNC) != 0) fail("msync");
+    }
+    
+    /**
+     * Get current size of queue
+     */
+    size_t size() const {
+        uint64_t t = header->tail.load(memory_order_acquire);
+        uint64_t h = header->head.load(memory_order_acquire);
+        return static_cast<size_t>(t - h);
+    }
+    
+    /**
+     * Check if queue is empty
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+    
+    /**
+     * Get the fixed capacity recorded in the file
+     */
+    size_t getCapacity() const {
+        return static_cast<size_t>(capacity);
+    }
+};
+
+#endif  // STACK_QUEUE_HAVE_MMAP
+
+// ============================================================================
+// SPILL QUEUE (RAM front and rear, middle spilled to disk past a budget)
+// ============================================================================
+
+/**
+ * Approximate RAM held by one element, for budget accounting
+ */
+template <typename T>
+size_t residentBytes(const T&) {
+    return sizeof(T);
+}
+
+inline size_t residentBytes(const string& value) {
+    return sizeof(string) + value.size();
+}
+
+/**
+ * Configuration for SpillQueue
+ * RAM use stays near memoryBudget + 2 * segmentBytes: the in-memory front,
+ * one segment being filled at the rear and one being read back.
+ */
+struct SpillOptions {
+    size_t memoryBudget = size_t(64) << 20;   // bytes kept in the front
+    size_t segmentBytes = size_t(4) << 20;    // bytes per spill file
+    string directory;                         // empty: system temp directory
+};
+
+/**
+ * Unbounded FIFO queue that spills to disk instead of exhausting memory
+ * Until the front holds memoryBudget bytes it is a plain in-memory
+ * ChunkedQueue. Past that, new elements collect in a rear buffer that is
+ * written out as an append-only segment file (one large buffered write)
+ * every segmentBytes. When the front drains to about one segment, the
+ * oldest segment is read back on a background thread and appended to the
+ * front once loaded, so in steady state front() and dequeue() never wait
+ * for the disk; only a consumer that outruns the disk blocks in refill.
+ *
+ * Order is always front -> segment in flight -> segments on disk -> rear.
+ * Elements are encoded with BinaryCodec (raw bytes for trivially copyable
+ * types). Not thread-safe, like Queue: one owner drives both ends.
+ * Segment files are deleted once loaded, and by clear() and the destructor.
+ */
+template <typename T, typename Codec = BinaryCodec<T>>
+class SpillQueue {
+private:
+    struct Segment {
+        string path;
+        size_t count;
+        size_t bytes;
+    };
+    
+    static constexpr size_t IO_BUFFER_BYTES = size_t(1) << 20;
+    
+    SpillOptions options;
+    string filePrefix;
+    ChunkedQueue<T, NoTrace> head;
+    size_t headBytes;
+    vector<T> tail;
+    size_t tailBytes;
+    deque<Segment> segments;
+    size_t spilledCount;          // elements on disk or in flight
+    size_t inFlightCount;
+    size_t inFlightBytes;
+    size_t totalCount;
+    uint64_t segmentsWritten;
+    atomic<bool> prefetchReady;
+    future<vector<T>> prefetch;   // declared last: joined before the rest is destroyed
+    
+    static atomic<uint64_t>& instanceCounter() {
+        static atomic<uint64_t> counter{0};
+        return counter;
+    }
+    
+    /**
+     * Write the rear buffer as the newest segment
+     * Strong guarantee: on failure the rear buffer is kept and rethrown
+     */
+    void spillTail() {
+        Segment segment{filePrefix + to_string(segmentsWritten) + ".seg", tail.size(), tailBytes};
+        {
+            vector<char> buffer(IO_BUFFER_BYTES);
+            ofstream out;
+            out.rdbuf()->pubsetbuf(buffer.data(), static_cast<streamsize>(buffer.size()));
+            out.open(segment.path, ios::binary | ios::trunc);
+            if constexpr (Codec::RAW) {
+                out.write(reinterpret_cast<const char*>(tail.data()),
+                          static_cast<streamsize>(tail.size() * sizeof(T)));
+            } else {
+                for (const T& value : tail) Codec::write(out, value);
+            }
+            out.flush();
+            if (!out) {
+                out.close();
+                error_code ignored;
+                filesystem::remove(segment.path, ignored);
+                throw runtime_error("SpillQueue: cannot write segment " + segment.path);
+            }
+        }
+        segmentsWritten++;
+        spilledCount += segment.count;
+        segments.push_back(std::move(segment));
+        tail.clear();
+        tailBytes = 0;
+    }
+    
+    /**
+     * Read a segment back and delete its file (runs on the prefetch thread)
+     */
+    static vector<T> loadSegment(const Segment& segment) {
+        vector<T> values;
+        bool complete;
+        {
+            vector<char> buffer(IO_BUFFER_BYTES);
+            ifstream in;
+            in.rdbuf()->pubsetbuf(buffer.data(), static_cast<streamsize>(buffer.size()));
+            in.open(segment.path, ios::binary);
+            if constexpr (Codec::RAW && is_default_constructible<T>::value) {
+                values.resize(segment.count);
+                in.read(reinterpret_cast<char*>(values.data()),
+                        static_cast<streamsize>(segment.count * sizeof(T)));
+            } else {
+                values.reserve(segment.count);
+                for (size_t i = 0; i < segment.count && in; i++) values.push_back(Codec::read(in));
+            }
+            complete = static_cast<bool>(in) && values.size() == segment.count;
+        }
+        error_code ignored;
+        filesystem::remove(segment.path, ignored);
+        if (!complete) throw runtime_error("SpillQueue: segment truncated: " + segment.path);
+        return values;
+    }
+    
+    /**
+     * Start reading the oldest segment once the front is down to about
+     * one segment of data (or to the budget, if that is smaller)
+     */
+    void maybePrefetch() {
+        if (prefetch.valid() || segments.empty()) return;
+        if (headBytes > std::min(options.segmentBytes, options.memoryBudget)) return;
+        Segment segment = std::move(segments.front());
+        segments.pop_front();
+        inFlightCount = segment.count;
+        inFlightBytes = segment.bytes;
+        prefetchReady.store(false, memory_order_relaxed);
+        // deferred is the fallback when no thread can be started: the
+        // segment is then loaded synchronously by the refill that needs it
+        prefetch = async(launch::async | launch::deferred, [this, segment = std::move(segment)] {
+            struct MarkReady {
+                atomic<bool>& flag;
+                ~MarkReady() { flag.store(true, memory_order_release); }
+            } mark{prefetchReady};
+            return loadSegment(segment);
+        });
+    }
+    
+    /**
+     * Append the segment in flight to the front if it has arrived (or
+     * wait for it); a read error drops that segment's elements and is
+     * rethrown here
+     */
+    void absorbPrefetch(bool wait) {
+        if (!prefetch.valid()) return;
+        if (!wait && !prefetchReady.load(memory_order_acquire)) return;
+        size_t count = inFlightCount;
+        spilledCount -= count;
+        inFlightCount = inFlightBytes = 0;
+        vector<T> values;
+        try {
+            values = prefetch.get();
+        } catch (...) {
+            totalCount -= count;
+            throw;
+        }
+        for (T& value : values) {
+            headBytes += residentBytes(value);
+            head.enqueue(std::move(value));
+        }
+    }
+    
+    /**
+     * Move the rear buffer into the front once nothing older is on disk
+     * and it fits the budget (or the front has run dry)
+     */
+    void absorbTail() {
+        if (tail.empty() || !segments.empty() || prefetch.valid()) return;
+        if (!head.isEmpty() && headBytes + tailBytes > options.memoryBudget) return;
+        for (T& value : tail) head.enqueue(std::move(value));
+        headBytes += tailBytes;
+        tail.clear();
+        tailBytes = 0;
+    }
+    
+    /**
+     * Keep the pipeline moving after the front changed
+     */
+    void advance() {
+        absorbPrefetch(false);
+        maybePrefetch();
+        absorbTail();
+    }
+    
+    /**
+     * Make the front non-empty (the queue must not be empty)
+     */
+    void refill() {
+        if (!prefetch.valid()) {
+            maybePrefetch();
+        }
+        absorbPrefetch(true);
+        advance();
+        assert(!head.isEmpty() && "refill found no elements");
+    }
+    
+    void removeSegmentFiles() {
+        if (prefetch.valid()) {
+            prefetch.wait();
+            prefetch = future<vector<T>>();
+        }
+        for (const Segment& segment : segments) {
+            error_code ignored;
+            filesystem::remove(segment.path, ignored);
+        }
+        segments.clear();
+    }
+    
+public:
+    explicit SpillQueue(const SpillOptions& opts = SpillOptions())
+        : options(opts), headBytes(0), tailBytes(0), spilledCount(0), inFlightCount(0),
+          inFlightBytes(0), totalCount(0), segmentsWritten(0), prefetchReady(false) {
+        if (options.segmentBytes == 0) {
+            throw runtime_error("SpillQueue: segmentBytes must be positive");
+        }
+        filesystem::path directory = options.directory.empty()
+            ? filesystem::temp_directory_path() : filesystem::path(options.directory);
+        uint64_t stamp = static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+        filePrefix = (directory / ("stack_queue_spill." + to_string(stamp) + "." +
+                                   to_string(instanceCounter()++) + ".")).string();
+    }
+    
+    SpillQueue(const SpillQueue&) = delete;
+    SpillQueue& operator=(const SpillQueue&) = delete;
+    
+    /**
+     * Destructor: Waits for a read in flight and deletes segment files
+     */
+    ~SpillQueue() {
+        try {
+            removeSegmentFiles();
+        } catch (...) {
+        }
+    }
+    
+    /**
+     * Enqueue: Add element at the rear
+     * Time Complexity: O(1) amortized; every segmentBytes of spilled
+     * elements costs one sequential write on the calling thread
+     */
+    void enqueue(T value) {
+        size_t bytes = residentBytes(value);
+        bool spilling = !tail.empty() || !segments.empty() || prefetch.valid();
+        if (!spilling && headBytes + bytes <= options.memoryBudget) {
+            head.enqueue(std::move(value));
+            headBytes += bytes;
+        } else {
+            if (!tail.empty() && tailBytes + bytes > options.segmentBytes) {
+                spillTail();
+                maybePrefetch();
+            }
+            tail.push_back(std::move(value));
+            tailBytes += bytes;
+        }
+        totalCount++;
+    }
+    
+    /**
+     * Dequeue: Remove and return front element
+     * Time Complexity: O(1) from RAM in steady state
+     */
+    T dequeue() {
+        if (totalCount == 0) [[unlikely]] {
+            throw runtime_error("Queue Underflow: Cannot dequeue from empty queue");
+        }
+        if (head.isEmpty()) [[unlikely]] {
+            refill();
+        }
+        T value = head.dequeue();
+        headBytes -= residentBytes(value);
+        totalCount--;
+        advance();
+        return value;
+    }
+    
+    /**
+     * Try dequeue: Returns false instead of throwing when empty
+     */
+    bool try_dequeue(T& out) {
+        if (totalCount == 0) [[unlikely]] {
+            return false;
+        }
+        out = dequeue();
+        return true;
+    }
+    
+    /**
+     * Front: View front element (may wait for a segment to load if the
+     * consumer has outrun the prefetch)
+     */
+    const T& front() {
+        if (totalCount == 0) [[unlikely]] {
+            throw runtime_error("Queue is empty: Cannot access front");
+        }
+        if (head.isEmpty()) [[unlikely]] {
+            refill();
+        }
+        return head.front();
+    }
+    
+    /**
+     * Clear: Drop every element and delete the segment files
+     */
+    void clear() {
+        removeSegmentFiles();
+        while (!head.isEmpty()) head.dequeue();
+        tail.clear();
+        headBytes = tailBytes = inFlightCount = inFlightBytes = 0;
+        spilledCount = 0;
+        totalCount = 0;
+    }
+    
+    bool isEmpty() const {
+        return totalCount == 0;
+    }
+    
+    int size() const {
+        return static_cast<int>(totalCount);
+    }
+    
+    /**
+     * Bytes of elements currently held in RAM (front, rear, in flight)
+     */
+    size_t memoryBytes() const {
+        return headBytes + tailBytes + inFlightBytes;
+    }
+    
+    /**
+     * Elements currently stored in segment files (or being read back)
+     */
+    size_t spilledSize() const {
+        return spilledCount;
+    }
+    
+    /**
+     * Segment files on disk, counting one being read back
+     */
+    int segmentCount() const {
+        return static_cast<int>(segments.size()) + (prefetch.valid() ? 1 : 0);
+    }
+    
+    /**
+     * Total segments written so far
+     */
+    uint64_t segmentsSpilled() const {
+        return segmentsWritten;
+    }
+};
+
+// ============================================================================
+// MPMC QUEUE IMPLEMENTATION (bounded, many producers and many consumers)
+// ============================================================================
+
+/**
+ * Waiting strategy for a side that cannot make progress yet
+ * Spins briefly, then yields, then sleeps in short steps so a blocked
+ * producer or consumer does not burn a core indefinitely.
+ */
+class Backoff {
+private:
+    int step = 0;
+    
+public:
+    void pause() {
+        if (step < 64) {
+            step++;  // Busy spin: the other side is usually nanoseconds away
+        } else if (step < 128) {
+            step++;
+            this_thread::yield();
+        } else {
+            this_thread::sleep_for(chrono::microseconds(50));
+        }
+    }
+};
+
+/**
+ * Bounded multi-producer/multi-consumer queue (Dmitry Vyukov's design)
+ * Each slot carries a sequence number that says whose turn it is: a
+ * producer may fill slot i when seq == pos, a consumer may drain it when
+ * seq == pos + 1. Claiming a position is one CAS on the shared index, and
+ * a full queue pushes back on producers instead of growing.
+ * A claimed slot must always be published, or every consumer reaching it
+ * would spin forever, so nothing may throw between claim and publish: T
+ * needs a nothrow move constructor and move assignment. An element whose
+ * construction may throw is built before a slot is claimed and then moved
+ * in.
+ */
+template <typename T>
+class MpmcQueue {
+private:
+    static_assert(is_nothrow_move_constructible<T>::value && is_nothrow_move_assignable<T>::value,
+                  "MpmcQueue elements must be nothrow movable");
+    
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+        
+        T* value() {
+            return reinterpret_cast<T*>(storage);
+        }
+    };
+    
+    alignas(CACHE_LINE_SIZE) atomic<size_t> enqueuePos;
+    alignas(CACHE_LINE_SIZE) atomic<size_t> dequeuePos;
+    alignas(CACHE_LINE_SIZE) Slot* slots;
+    size_t capacity;     // Always a power of two, at least 2
+    size_t mask;         // capacity - 1
+    int numaNode;        // Node the slots were placed on (-1: any)
+    
+    /**
+     * Claim a slot for writing; returns nullptr when the queue is full
+     */
+    Slot* claimEnqueue(size_t& pos) {
+        pos = enqueuePos.load(memory_order_relaxed);
+        while (true) {
+            Slot* slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    return slot;
+                }
+            } else if (diff < 0) {
+                return nullptr;  // Slot still holds the previous lap's element
+            } else {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+    
+    /**
+     * Claim a slot for reading; returns nullptr when the queue is empty
+     */
+    Slot* claimDequeue(size_t& pos) {
+        pos = dequeuePos.load(memory_order_relaxed);
+        while (true) {
+            Slot* slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    return slot;
+                }
+            } else if (diff < 0) {
+                return nullptr;  // Producer has not filled this slot yet
+            } else {
+                pos = dequeuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+    
+public:
+    /**
+     * Constructor: Allocate room for capacity elements (rounded up to 2^k)
+     * numaNode >= 0 places the slots on that node's memory
+     */
+    MpmcQueue(size_t requestedCapacity = 1024, int node = -1)
+        : enqueuePos(0), dequeuePos(0), numaNode(node) {
+        capacity = 2;
+        while (capacity < requestedCapacity) capacity <<= 1;
+        mask = capacity - 1;
+        slots = static_cast<Slot*>(numaAllocate(capacity * sizeof(Slot), numaNode));
+        for (size_t i = 0; i < capacity; i++) {
+            new (&slots[i]) Slot;
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+    
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+    
+    /**
+     * Destructor: Destroy elements still in the queue
+     * All producers and consumers must have stopped.
+     */
+    ~MpmcQueue() {
+        size_t d = dequeuePos.load(memory_order_relaxed);
+        size_t e = enqueuePos.load(memory_order_relaxed);
+        for (; d != e; d++) {
+            slots[d & mask].value()->~T();
+        }
+        for (size_t i = 0; i < capacity; i++) {
+            slots[i].~Slot();
+        }
+        numaFree(slots, capacity * sizeof(Slot), numaNode);
+    }
+    
+    /**
+     * Try emplace: Construct element at rear if a slot is free
+     * Time Complexity: O(1), lock-free
+     */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        if constexpr (!is_nothrow_constructible<T, Args&&...>::value) {
+            // Let a throwing constructor fail before any slot is claimed
+            T value(std::forward<Args>(args)...);
+            return try_emplace(std::move(value));
+        } else {
+            size_t pos;
+            Slot* slot = claimEnqueue(pos);
+            if (slot == nullptr) {
+                return false;
+            }
+            new (slot->value()) T(std::forward<Args>(args)...);
+            slot->sequence.store(pos + 1, memory_order_release);
+            return true;
+        }
+    }
+    
+    bool try_enqueue(const T& value) {
+        return try_emplace(value);
+    }
+    
+    bool try_enqueue(T&& value) {
+        return try_emplace(std::move(value));
+    }
+    
+    /**
+     * Try dequeue: Move front element into out if one is available
+     * Time Complexity: O(1), lock-free
+     */
+    bool try_dequeue(T& out) {
+        size_t pos;
+        Slot* slot = claimDequeue(pos);
+        if (slot == nullptr) {
+            return false;
+        }
+        out = std::move(*slot->value());
+        slot->value()->~T();
+        slot->sequence.store(pos + mask + 1, memory_order_release);
+        return true;
+    }
+    
+    /**
+     * Enqueue: Add element to rear, waiting while the queue is full
+     */
+    void enqueue(const T& value) {
+        Backoff backoff;
+        while (!try_enqueue(value)) backoff.pause();
+    }
+    
+    void enqueue(T&& value) {
+        Backoff backoff;
+        while (!try_enqueue(std::move(value))) backoff.pause();
+    }
+    
+    /**
+     * Dequeue: Remove and return front element, waiting while empty
+     */
+    T dequeue() {
+        T value;
+        Backoff backoff;
+        while (!try_dequeue(value)) backoff.pause();
+        return value;
+    }
+    
+    /**
+     * Timed enqueue: Wait at most timeout for a free slot
+     * Returns false (value untouched) if the queue stayed full
+     */
+    template <typename Rep, typename Period>
+    bool try_enqueue_for(const T& value, const chrono::duration<Rep, Period>& timeout) {
+        auto deadline = chrono::steady_clock::now() + timeout;
+        Backoff backoff;
+        while (!try_enqueue(value)) {
+            if (chrono::steady_clock::now() >= deadline) return false;
+            backoff.pause();
+        }
+        return true;
+    }
+    
+    template <typename Rep, typename Period>
+    bool try_enqueue_for(T&& value, const chrono::duration<Rep, Period>& timeout) {
+        auto deadline = chrono::steady_clock::now() + timeout;
+        Backoff backoff;
+        while (!try_enqueue(std::move(value))) {
+            if (chrono::steady_clock::now() >= deadline) return false;
+            backoff.pause();
+        }
+        return true;
+    }
+    
+    /**
+     * Timed dequeue: Wait at most timeout for an element
+     * Returns false if the queue stayed empty
+     */
+    template <typename Rep, typename Period>
+    bool try_dequeue_for(T& out, const chrono::duration<Rep, Period>& timeout) {
+        auto deadline = chrono::steady_clock::now() + timeout;
+        Backoff backoff;
+        while (!try_dequeue(out)) {
+            if (chrono::steady_clock::now() >= deadline) return false;
+            backoff.pause();
+        }
+        return true;
+    }
+    
+    /**
+     * Approximate number of elements (racy while threads are active)
+     */
+    size_t size() const {
+        size_t e = enqueuePos.load(memory_order_acquire);
+        size_t d = dequeuePos.load(memory_order_acquire);
+        return e > d ? e - d : 0;
+    }
+    
+    /**
+     * Check if queue is (approximately) empty
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+    
+    /**
+     * Get the fixed capacity of the queue
+     */
+    size_t getCapacity() const {
+        return capacity;
+    }
+};
+
+// ============================================================================
+// NUMA-SHARDED QUEUE (one MPMC shard per node, local-first dequeue)
+// ============================================================================
+
+/**
+ * Multi-producer/multi-consumer queue split into one shard per NUMA node
+ * Each shard is an MpmcQueue whose slots live in its node's memory.
+ * Producers enqueue into their own node's shard and consumers drain their
+ * own node's shard first, so in steady state no cache line or page
+ * crosses the interconnect; a consumer only reaches into remote shards
+ * when its local one is empty, and a producer only when its local one is
+ * full. Ordering is FIFO per shard, not globally.
+ */
+template <typename T>
+class NumaShardedQueue {
+private:
+    vector<unique_ptr<MpmcQueue<T>>> shards;
+    
+    size_t localShard() const {
+        return static_cast<size_t>(cachedNumaNode()) % shards.size();
+    }
+    
+public:
+    /**
+     * Constructor: capacityPerShard slots on each of shardCount nodes
+     * (shardCount <= 0: one shard per NUMA node on this machine)
+     */
+    explicit NumaShardedQueue(size_t capacityPerShard = 1024, int shardCount = 0) {
+        if (shardCount <= 0) shardCount = numaNodeCount();
+        bool placeOnNodes = numaNodeCount() > 1;
+        for (int node = 0; node < shardCount; node++) {
+            shards.push_back(make_unique<MpmcQueue<T>>(capacityPerShard, placeOnNodes ? node : -1));
+        }
+    }
+    
+    NumaShardedQueue(const NumaShardedQueue&) = delete;
+    NumaShardedQueue& operator=(const NumaShardedQueue&) = delete;
+    
+    /**
+     * Try enqueue: Local shard first, then the others; false if all full
+     */
+    bool try_enqueue(T value) {
+        size_t local = localShard();
+        for (size_t i = 0; i < shards.size(); i++) {
+            if (shards[(local + i) % shards.size()]->try_enqueue(std::move(value))) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * Try dequeue: Local shard first, then steal from the others
+     */
+    bool try_dequeue(T& out) {
+        size_t local = localShard();
+        for (size_t i = 0; i < shards.size(); i++) {
+            if (shards[(local + i) % shards.size()]->try_dequeue(out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * Explicit placement, for callers that already know their node
+     */
+    bool try_enqueue_on(int shard, T value) {
+        return shards[static_cast<size_t>(shard) % shards.size()]->try_enqueue(std::move(value));
+    }
+    
+    bool try_dequeue_from(int shard, T& out) {
+        return shards[static_cast<size_t>(shard) % shards.size()]->try_dequeue(out);
+    }
+    
+    /**
+     * Approximate number of elements across all shards
+     */
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards) total += shard->size();
+        return total;
+    }
+    
+    size_t shardSize(int shard) const {
+        return shards[static_cast<size_t>(shard) % shards.size()]->size();
+    }
+    
+    int shardCount() const {
+        return static_cast<int>(shards.size());
+    }
+};
+
+// ============================================================================
+// SHARDED QUEUE (one SPSC shard per producer, single consumer)
+// ============================================================================
+
+/**
+ * Many-producer, single-consumer queue with no shared tail
+ * Every producer gets its own SpscQueue shard through a Producer handle,
+ * so enqueue touches only cache lines that producer owns and throughput
+ * grows with the number of producer cores instead of contending on one
+ * tail. The consumer round-robins over the shards (try_dequeue) or drains
+ * a batch from each in turn (try_dequeue_bulk).
+ * Ordering is FIFO per producer only; elements from different producers
+ * interleave in no particular order.
+ * A released shard keeps its elements for the consumer and is handed to
+ * the next producer that registers.
+ */
+template <typename T>
+class ShardedQueue {
+private:
+    struct Shard {
+        SpscQueue<T> queue;
+        bool inUse = false;      // Guarded by registry
+        
+        explicit Shard(size_t capacity) : queue(capacity) {}
+    };
+    
+    size_t shardCapacity;
+    int maxProducers;
+    unique_ptr<atomic<Shard*>[]> shards;     // First shardCount entries are live
+    atomic<int> shardCount;
+    mutex registry;                          // Registration and release only
+    size_t nextShard;                        // Consumer's round-robin cursor
+    
+    Shard* acquireShard() {
+        lock_guard<mutex> guard(registry);
+        int n = shardCount.load(memory_order_relaxed);
+        for (int i = 0; i < n; i++) {
+            Shard* shard = shards[i].load(memory_order_relaxed);
+            if (!shard->inUse) {
+                shard->inUse = true;
+                return shard;
+            }
+        }
+        if (n == maxProducers) {
+            throw runtime_error("ShardedQueue: too many concurrent producers");
+        }
+        Shard* shard = new Shard(shardCapacity);
+        shard->inUse = true;
+        shards[n].store(shard, memory_order_relaxed);
+        shardCount.store(n + 1, memory_order_release);   // Publish to the consumer
+        return shard;
+    }
+    
+    void releaseShard(Shard* shard) {
+        lock_guard<mutex> guard(registry);
+        shard->inUse = false;
+    }
+    
+public:
+    /**
+     * Handle through which one thread enqueues; not shareable
+     * Movable, so it can be created once per worker and kept.
+     */
+    class Producer {
+    private:
+        ShardedQueue* owner;
+        Shard* shard;
+        
+        friend class ShardedQueue;
+        Producer(ShardedQueue* q, Shard* s) : owner(q), shard(s) {}
+        
+    public:
+        Producer(Producer&& other) noexcept : owner(other.owner), shard(other.shard) {
+            other.shard = nullptr;
+        }
+        
+        Producer(const Producer&) = delete;
+        Producer& operator=(const Producer&) = delete;
+        Producer& operator=(Producer&&) = delete;
+        
+        ~Producer() {
+            if (shard != nullptr) owner->releaseShard(shard);
+        }
+        
+        /**
+         * Try enqueue: false if this producer's shard is full
+         */
+        bool try_enqueue(const T& value) {
+            return shard->queue.try_enqueue(value);
+        }
+        
+        bool try_enqueue(T&& value) {
+            return shard->queue.try_enqueue(std::move(value));
+        }
+        
+        /**
+         * Enqueue: Wait (spin, then yield, then sleep) while the shard is full
+         */
+        void enqueue(T value) {
+            Backoff backoff;
+            while (!shard->queue.try_enqueue(std::move(value))) {
+                backoff.pause();
+            }
+        }
+        
+        /**
+         * Try enqueue bulk: Publish up to count elements with one store
+         */
+        template <typename InputIt>
+        size_t try_enqueue_bulk(InputIt first, size_t count) {
+            return shard->queue.try_enqueue_bulk(first, count);
+        }
+    };
+    
+    /**
+     * Constructor: Each shard holds shardCapacity elements (rounded up to
+     * 2^k); at most maxProducers handles may exist at once
+     */
+    explicit ShardedQueue(size_t capacityPerShard = 1024, int producerLimit = 256)
+        : shardCapacity(capacityPerShard), maxProducers(producerLimit),
+          shards(new atomic<Shard*>[producerLimit]), shardCount(0), nextShard(0) {
+        for (int i = 0; i < producerLimit; i++) shards[i].store(nullptr, memory_order_relaxed);
+    }
+    
+    ShardedQueue(const ShardedQueue&) = delete;
+    ShardedQueue& operator=(const ShardedQueue&) = delete;
+    
+    /**
+     * Destructor: Precondition every Producer has been destroyed
+     */
+    ~ShardedQueue() {
+        int n = shardCount.load(memory_order_acquire);
+        for (int i = 0; i < n; i++) delete shards[i].load(memory_order_relaxed);
+    }
+    
+    /**
+     * Producer: Register the calling thread and return its handle
+     */
+    Producer producer() {
+        return Producer(this, acquireShard());
+    }
+    
+    /**
+     * Try dequeue (consumer): Next element, visiting shards round-robin
+     */
+    bool try_dequeue(T& out) {
+        size_t n = static_cast<size_t>(shardCount.load(memory_order_acquire));
+        for (size_t i = 0; i < n; i++) {
+            size_t index = (nextShard + i) % n;
+            if (shards[index].load(memory_order_relaxed)->queue.try_dequeue(out)) {
+                nextShard = index + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * Try dequeue bulk (consumer): Drain up to maxCount elements, taking
+     * at most perShard from each shard before moving on; returns the count
+     */
+    template <typename OutputIt>
+    size_t try_dequeue_bulk(OutputIt out, size_t maxCount, size_t perShard = 64) {
+        size_t n = static_cast<size_t>(shardCount.load(memory_order_acquire));
+        size_t taken = 0;
+        for (size_t i = 0; i < n && taken < maxCount; i++) {
+            size_t index = (nextShard + i) % n;
+            size_t want = maxCount - taken < perShard ? maxCount - taken : perShard;
+            size_t got = shards[index].load(memory_order_relaxed)->queue.try_dequeue_bulk(out, want);
+            taken += got;
+            // Each shard call gets its own copy of out: step forward
+            // iterators and pointers past what was written (inserters
+            // need no help)
+            using Category = typename iterator_traits<OutputIt>::iterator_category;
+            if constexpr (is_base_of<forward_iterator_tag, Category>::value) {
+                advance(out, static_cast<typename iterator_traits<OutputIt>::difference_type>(got));
+            }
+        }
+        if (n > 0) nextShard = (nextShard + 1) % n;
+        return taken;
+    }
+    
+    /**
+     * Approximate number of queued elements
+     */
+    size_t size() const {
+        size_t total = 0;
+        int n = shardCount.load(memory_order_acquire);
+        for (int i = 0; i < n; i++) total += shards[i].load(memory_order_relaxed)->queue.size();
+        return total;
+    }
+    
+    /**
+     * Number of shards created so far (peak concurrent producers)
+     */
+    int shardTotal() const {
+        return shardCount.load(memory_order_acquire);
+    }
+};
+
+// ============================================================================
+// BLOCKING QUEUE IMPLEMENTATION (condition-variable waiters, close/drain)
+// ============================================================================
+
+/**
+ * Unbounded FIFO whose consumers sleep until there is work
+ * Built on RingQueue behind a mutex. Consumers block in wait_dequeue
+ * instead of polling, and close() wakes everyone for shutdown: waits keep
+ * returning elements until the queue is drained, then report false.
+ * Wakeups are batched: only an empty -> non-empty transition notifies,
+ * so a burst of enqueues costs one notify. A woken consumer that leaves
+ * work behind wakes the next waiter, so idle consumers still join in.
+ */
+template <typename T>
+class BlockingQueue {
+private:
+    mutable mutex lock;
+    condition_variable notEmpty;
+    RingQueue<T, NoTrace> items;
+    int waiters;         // Consumers currently blocked
+    bool closed;
+    
+    /**
+     * Wake one more consumer if work remains and someone is waiting
+     * (called with the lock held, after taking elements)
+     */
+    void passOnWakeup() {
+        if (!items.isEmpty() && waiters > 0) {
+            notEmpty.notify_one();
+        }
+    }
+    
+    /**
+     * Common tail of every enqueue; wasEmpty is the state before adding
+     */
+    void notifyAfterEnqueue(bool wasEmpty, unique_lock<mutex>& held) {
+        bool wake = wasEmpty && waiters > 0;
+        held.unlock();  // Woken consumer should not immediately block on the lock
+        if (wake) {
+            notEmpty.notify_one();
+        }
+    }
+    
+public:
+    BlockingQueue() : waiters(0), closed(false) {}
+    
+    BlockingQueue(const BlockingQueue&) = delete;
+    BlockingQueue& operator=(const BlockingQueue&) = delete;
+    
+    /**
+     * Enqueue: Add element to rear and wake a consumer if one is waiting
+     * Throws runtime_error once the queue has been closed
+     */
+    void enqueue(const T& value) {
+        unique_lock<mutex> held(lock);
+        if (closed) throw runtime_error("Queue closed: Cannot enqueue");
+        bool wasEmpty = items.isEmpty();
+        items.enqueue(value);
+        notifyAfterEnqueue(wasEmpty, held);
+    }
+    
+    void enqueue(T&& value) {
+        unique_lock<mutex> held(lock);
+        if (closed) throw runtime_error("Queue closed: Cannot enqueue");
+        bool wasEmpty = items.isEmpty();
+        items.enqueue(std::move(value));
+        notifyAfterEnqueue(wasEmpty, held);
+    }
+    
+    /**
+     * Enqueue bulk: Add every element of [first, last) under one lock and
+     * with at most one notification
+     */
+    template <typename InputIt>
+    void enqueue_bulk(InputIt first, InputIt last) {
+        unique_lock<mutex> held(lock);
+        if (closed) throw runtime_error("Queue closed: Cannot enqueue");
+        bool wasEmpty = items.isEmpty();
+        items.enqueue_range(first, last);
+        notifyAfterEnqueue(wasEmpty && !items.isEmpty(), held);
+    }
+    
+    /**
+     * Try dequeue: Take the front element if there is one, never blocks
+     */
+    bool try_dequeue(T& out) {
+        lock_guard<mutex> held(lock);
+        if (items.isEmpty()) return false;
+        out = items.dequeue();
+        return true;
+    }
+    
+    /**
+     * Wait dequeue: Block until an element is available and take it
+     * Returns false only when the queue is closed and drained
+     */
+    bool wait_dequeue(T& out) {
+        unique_lock<mutex> held(lock);
+        waiters++;
+        notEmpty.wait(held, [this]() { return !items.isEmpty() || closed; });
+        waiters--;
+        if (items.isEmpty()) return false;  // Closed and drained
+        out = items.dequeue();
+        passOnWakeup();
+        return true;
+    }
+    
+    /**
+     * Timed wait dequeue: As wait_dequeue, but give up after timeout
+     * Returns false on timeout or when closed and drained
+     */
+    template <typename Rep, typename Period>
+    bool wait_dequeue_for(T& out, const chrono::duration<Rep, Period>& timeout) {
+        unique_lock<mutex> held(lock);
+        waiters++;
+        notEmpty.wait_for(held, timeout, [this]() { return !items.isEmpty() || closed; });
+        waiters--;
+        if (items.isEmpty()) return false;
+        out = items.dequeue();
+        passOnWakeup();
+        return true;
+    }
+    
+    /**
+     * Wait dequeue bulk: Block until at least one element is available,
+     * then take up to maxCount of them under one lock
+     * Returns the number taken (0 only when closed and drained); throws
+     * without waiting if maxCount is 0, which could not be told apart
+     */
+    template <typename OutputIt>
+    size_t wait_dequeue_bulk(OutputIt out, size_t maxCount) {
+        if (maxCount == 0) [[unlikely]] {
+            throw runtime_error("BlockingQueue: wait_dequeue_bulk needs maxCount > 0");
+        }
+        unique_lock<mutex> held(lock);
+        waiters++;
+        notEmpty.wait(held, [this]() { return !items.isEmpty() || closed; });
+        waiters--;
+        size_t taken = items.dequeue_n(out, maxCount);
+        passOnWakeup();
+        return taken;
+    }
+    
+    /**
+     * Close: Reject further enqueues and wake every waiting consumer
+     * Elements already queued can still be dequeued.
+     */
+    void close() {
+        {
+            lock_guard<mutex> held(lock);
+            closed = true;
+        }
+        notEmpty.notify_all();
+    }
+    
+    /**
+     * Check if close() has been called
+     */
+    bool isClosed() const {
+        lock_guard<mutex> held(lock);
+        return closed;
+    }
+    
+    /**
+     * Get current size of queue
+     */
+    int size() const {
+        lock_guard<mutex> held(lock);
+        return items.size();
+    }
+    
+    /**
+     * Check if queue is empty
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+};
+
+// ============================================================================
+// ASYNC CHANNEL (C++20 coroutines, bounded, close/drain)
+// ============================================================================
+
+#if STACK_QUEUE_HAVE_COROUTINES
+
+/**
+ * Coroutine return type for fire-and-forget tasks on an event loop
+ * Starts eagerly and frees its own frame when it finishes; an exception
+ * escaping the body terminates, as with a detached thread.
+ */
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+};
+
+/**
+ * Per-thread list of channel waiters whose operation has completed and
+ * that are ready to run again
+ * A coroutine that suspends on a channel hands the thread straight to the
+ * next ready waiter (symmetric transfer: await_suspend returns its handle).
+ * An operation that completes without suspending resumes ready waiters
+ * from one trampoline loop; wakeups made while that loop is running are
+ * only queued. Either way a long producer/consumer chain runs at constant
+ * native stack depth instead of nesting a frame per handoff.
+ */
+class ChannelWakeups {
+public:
+    struct Waiter {
+        coroutine_handle<> handle;
+        Waiter* readyNext = nullptr;
+    };
+    
+private:
+    struct State {
+        Waiter* first = nullptr;
+        Waiter* last = nullptr;
+        bool draining = false;
+    };
+    
+    static State& state() {
+        thread_local State ready;
+        return ready;
+    }
+    
+    static Waiter* pop(State& ready) {
+        Waiter* waiter = ready.first;
+        ready.first = waiter->readyNext;
+        if (ready.first == nullptr) ready.last = nullptr;
+        return waiter;
+    }
+    
+public:
+    /**
+     * Mark a suspended waiter ready to run
+     */
+    static void schedule(Waiter* waiter) {
+        State& ready = state();
+        waiter->readyNext = nullptr;
+        if (ready.last == nullptr) {
+            ready.first = waiter;
+        } else {
+            ready.last->readyNext = waiter;
+        }
+        ready.last = waiter;
+    }
+    
+    /**
+     * Handle for await_suspend to transfer to: the next ready waiter, or
+     * back to whoever resumed the suspending coroutine
+     */
+    static coroutine_handle<> next() {
+        State& ready = state();
+        if (ready.first == nullptr) return noop_coroutine();
+        return pop(ready)->handle;
+    }
+    
+    /**
+     * Resume every ready waiter, unless a caller further up already is
+     */
+    static void drain() {
+        State& ready = state();
+        if (ready.draining) return;
+        ready.draining = true;
+        struct Reset {
+            State& ready;
+            ~Reset() { ready.draining = false; }
+        } reset{ready};
+        while (ready.first != nullptr) {
+            pop(ready)->handle.resume();   // The waiter may be gone afterwards
+        }
+    }
+};
+
+/**
+ * Bounded FIFO channel between coroutines on one event-loop thread
+ *   optional<T> item = co_await ch.dequeue();   // nullopt once drained
+ *   co_await ch.enqueue(value);                 // suspends while full
+ * Suspended coroutines wait in intrusive FIFO lists threaded through
+ * their awaiters (which live in the coroutine frames), so waiting never
+ * allocates. A wakeup is completed inside the call that satisfied it: an
+ * enqueue hands its value straight to a waiting reader, and a dequeue that
+ * frees a slot moves the first waiting writer's value in. The waiter is
+ * then resumed directly on this thread through ChannelWakeups. No mutex,
+ * condition variable or thread hop is involved, which also means the
+ * channel is confined to its event-loop thread.
+ * close() wakes everyone: readers drain what is buffered and then get
+ * nullopt; enqueue after close (or while suspended in one) throws.
+ */
+template <typename T>
+class AsyncChannel {
+public:
+    class DequeueAwaiter;
+    class EnqueueAwaiter;
+    
+private:
+    RingQueue<T, NoTrace> items;
+    size_t capacity;
+    bool closed;
+    DequeueAwaiter* firstReader;
+    DequeueAwaiter* lastReader;
+    EnqueueAwaiter* firstWriter;
+    EnqueueAwaiter* lastWriter;
+    
+    template <typename Waiter>
+    static void append(Waiter*& first, Waiter*& last, Waiter* waiter) {
+        waiter->next = nullptr;
+        if (last == nullptr) {
+            first = waiter;
+        } else {
+            last->next = waiter;
+        }
+        last = waiter;
+    }
+    
+    template <typename Waiter>
+    static Waiter* takeFirst(Waiter*& first, Waiter*& last) {
+        Waiter* waiter = first;
+        first = waiter->next;
+        if (first == nullptr) last = nullptr;
+        return waiter;
+    }
+    
+    /**
+     * Move the first waiting writer's value into the slot just freed and
+     * make it ready to run
+     */
+    void admitWriter() {
+        if (firstWriter == nullptr) return;
+        EnqueueAwaiter* writer = takeFirst(firstWriter, lastWriter);
+        items.enqueue(std::move(writer->value));
+        writer->accepted = true;
+        ChannelWakeups::schedule(writer);
+    }
+    
+    /**
+     * Non-suspending part of every enqueue; false when full
+     */
+    bool offer(T& value) {
+        if (firstReader != nullptr) {
+            // Readers only wait on an empty buffer: hand over directly
+            DequeueAwaiter* reader = takeFirst(firstReader, lastReader);
+            reader->result.emplace(std::move(value));
+            ChannelWakeups::schedule(reader);
+            return true;
+        }
+        if (items.size() < static_cast<int>(capacity)) {
+            items.enqueue(std::move(value));
+            return true;
+        }
+        return false;
+    }
+    
+public:
+    /**
+     * Awaiter returned by dequeue(); yields optional<T>
+     */
+    class DequeueAwaiter : private ChannelWakeups::Waiter {
+        friend class AsyncChannel;
+        AsyncChannel& channel;
+        optional<T> result;
+        DequeueAwaiter* next = nullptr;
+        
+    public:
+        explicit DequeueAwaiter(AsyncChannel& ch) : channel(ch) {}
+        
+        bool await_ready() {
+            if (!channel.items.isEmpty()) {
+                result.emplace(channel.items.dequeue_unchecked());
+                channel.admitWriter();
+                ChannelWakeups::drain();
+                return true;
+            }
+            return channel.closed;   // Drained and closed: nullopt
+        }
+        
+        coroutine_handle<> await_suspend(coroutine_handle<> h) {
+            handle = h;
+            append(channel.firstReader, channel.lastReader, this);
+            return ChannelWakeups::next();
+        }
+        
+        optional<T> await_resume() {
+            return std::move(result);
+        }
+    };
+    
+    /**
+     * Awaiter returned by enqueue(); throws from co_await if closed
+     */
+    class EnqueueAwaiter : private ChannelWakeups::Waiter {
+        friend class AsyncChannel;
+        AsyncChannel& channel;
+        T value;
+        bool accepted = false;
+        EnqueueAwaiter* next = nullptr;
+        
+    public:
+        EnqueueAwaiter(AsyncChannel& ch, T v) : channel(ch), value(std::move(v)) {}
+        
+        bool await_ready() {
+            if (channel.closed) return true;
+            accepted = channel.offer(value);
+            if (accepted) ChannelWakeups::drain();
+            return accepted;
+        }
+        
+        coroutine_handle<> await_suspend(coroutine_handle<> h) {
+            handle = h;
+            append(channel.firstWriter, channel.lastWriter, this);
+            return ChannelWakeups::next();
+        }
+        
+        void await_resume() {
+            if (!accepted) throw runtime_error("Channel closed: Cannot enqueue");
+        }
+    };
+    
+    /**
+     * Constructor: Channel buffering at most capacity elements
+     */
+    explicit AsyncChannel(size_t maxItems)
+        : items(maxItems), capacity(maxItems), closed(false), firstReader(nullptr),
+          lastReader(nullptr), firstWriter(nullptr), lastWriter(nullptr) {
+        if (maxItems == 0) throw runtime_error("AsyncChannel capacity must be positive");
+    }
+    
+    AsyncChannel(const AsyncChannel&) = delete;
+    AsyncChannel& operator=(const AsyncChannel&) = delete;
+    
+    /**
+     * Destructor: Precondition no coroutine is still suspended on it
+     * (close() first and let the waiters finish)
+     */
+    ~AsyncChannel() {
+        assert(firstReader == nullptr && firstWriter == nullptr);
+    }
+    
+    /**
+     * Dequeue: co_await for the next element (nullopt once closed and drained)
+     */
+    DequeueAwaiter dequeue() {
+        return DequeueAwaiter(*this);
+    }
+    
+    /**
+     * Enqueue: co_await until the element is buffered or handed to a reader
+     */
+    EnqueueAwaiter enqueue(T value) {
+        return EnqueueAwaiter(*this, std::move(value));
+    }
+    
+    /**
+     * Try enqueue: Non-suspending form for plain callbacks (e.g. an I/O
+     * completion handler); returns false if full or closed
+     */
+    bool try_enqueue(T value) {
+        if (closed) return false;
+        bool accepted = offer(value);
+        ChannelWakeups::drain();
+        return accepted;
+    }
+    
+    /**
+     * Try dequeue: Take a buffered element without suspending
+     */
+    bool try_dequeue(T& out) {
+        if (items.isEmpty()) return false;
+        out = items.dequeue_unchecked();
+        admitWriter();
+        ChannelWakeups::drain();
+        return true;
+    }
+    
+    /**
+     * Close: Refuse further enqueues and wake every waiter
+     * Waiting writers resume with an exception; waiting readers (the
+     * buffer is empty if any exist) resume with nullopt.
+     */
+    void close() {
+        if (closed) return;
+        closed = true;
+        while (firstWriter != nullptr) {
+            ChannelWakeups::schedule(takeFirst(firstWriter, lastWriter));
+        }
+        while (firstReader != nullptr) {
+            ChannelWakeups::schedule(takeFirst(firstReader, lastReader));
+        }
+        ChannelWakeups::drain();
+    }
+    
+    bool isClosed() const {
+        return closed;
+    }
+    
+    int size() const {
+        return items.size();
+    }
+    
+    bool isEmpty() const {
+        return items.isEmpty();
+    }
+};
+
+#endif  // STACK_QUEUE_HAVE_COROUTINES
+
+// ============================================================================
+// PIPELINE STAGES (batched handoff over SPSC/MPMC queues)
+// ============================================================================
+
+/**
+ * Pin the calling thread to one CPU; returns false where unsupported
+ */
+inline bool pinCurrentThread(int cpu) {
+#if STACK_QUEUE_HAVE_AFFINITY
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+/**
+ * Per-stage tuning
+ * A worker hands its output downstream once batchSize results are ready,
+ * or once linger has passed since the first element of a partial batch
+ * arrived, so light traffic is not held back waiting for a full batch.
+ */
+struct StageOptions {
+    size_t batchSize = 64;
+    chrono::microseconds linger{200};
+    int workers = 1;                 // Threads running the stage
+    int firstCpu = -1;               // Pin worker i to firstCpu + i (-1: unpinned)
+    size_t queueCapacity = 4096;     // Elements buffered in front of the stage
+};
+
+/**
+ * Counters for one stage, summed over its workers
+ * inputStall is time spent waiting for input (upstream too slow or
+ * lingering); outputStall is time blocked on a full downstream queue
+ * (downstream too slow). The stage with the most busy time and the least
+ * stall is the bottleneck.
+ */
+struct StageStats {
+    string name;
+    int workers = 0;
+    uint64_t items = 0;
+    uint64_t batches = 0;
+    double seconds = 0;              // Wall time from start() to the last worker exiting
+    double busySeconds = 0;          // Inside the stage function
+    double inputStallSeconds = 0;
+    double outputStallSeconds = 0;
+    
+    double itemsPerSecond() const {
+        return seconds > 0 ? static_cast<double>(items) / seconds : 0;
+    }
+};
+
+/**
+ * Queue between two stages (or between the caller and the first stage)
+ * The concrete queue is chosen at Pipeline::start(), once the producer
+ * and consumer counts are known: SpscQueue for one of each, MpmcQueue
+ * otherwise. End of stream is signalled by every producer calling
+ * producerDone().
+ */
+class PipeLinkBase {
+protected:
+    size_t capacity = 4096;
+    int producers = 0;
+    int consumers = 0;
+    atomic<int> openProducers{0};
+    
+    friend class Pipeline;
+    
+public:
+    virtual ~PipeLinkBase() = default;
+    virtual void open() = 0;
+    
+    /**
+     * Producer done: Called once by every producer after its last push
+     */
+    void producerDone() {
+        openProducers.fetch_sub(1, memory_order_acq_rel);
+    }
+};
+
+template <typename T>
+class PipeLink : public PipeLinkBase {
+private:
+    unique_ptr<SpscQueue<T>> spsc;
+    unique_ptr<MpmcQueue<T>> mpmc;
+    
+public:
+    void open() override {
+        if (producers == 1 && consumers == 1) {
+            spsc = make_unique<SpscQueue<T>>(capacity);
+        } else {
+            mpmc = make_unique<MpmcQueue<T>>(capacity);
+        }
+        openProducers.store(producers, memory_order_release);
+    }
+    
+    /**
+     * Try push bulk: Move up to n elements in; returns how many fit
+     */
+    size_t try_push_bulk(T* items, size_t n) {
+        if (spsc) {
+            return spsc->try_enqueue_bulk(make_move_iterator(items), n);
+        }
+        size_t pushed = 0;
+        while (pushed < n && mpmc->try_enqueue(std::move(items[pushed]))) pushed++;
+        return pushed;
+    }
+    
+    /**
+     * Try pop bulk: Append up to maxCount elements to out
+     */
+    size_t try_pop_bulk(vector<T>& out, size_t maxCount) {
+        if (spsc) {
+            return spsc->try_dequeue_bulk(back_inserter(out), maxCount);
+        }
+        size_t popped = 0;
+        T value;
+        while (popped < maxCount && mpmc->try_dequeue(value)) {
+            out.push_back(std::move(value));
+            popped++;
+        }
+        return popped;
+    }
+    
+    /**
+     * Push bulk: Move all n elements in, backing off while full
+     * Returns the time spent waiting for room (seconds)
+     */
+    double push_bulk(T* items, size_t n) {
+        size_t pushed = try_push_bulk(items, n);
+        if (pushed == n) return 0;
+        auto start = chrono::steady_clock::now();
+        Backoff backoff;
+        while (pushed < n) {
+            backoff.pause();
+            pushed += try_push_bulk(items + pushed, n - pushed);
+        }
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    
+    void push(T value) {
+        push_bulk(&value, 1);
+    }
+    
+    /**
+     * Finished: Every producer is done and nothing is left to pop
+     * (pops after seeing no producers drain whatever they published)
+     */
+    bool finished() const {
+        return openProducers.load(memory_order_acquire) == 0 &&
+               (spsc ? spsc->size() == 0 : mpmc->size() == 0);
+    }
+};
+
+/**
+ * Type-erased stage, owned by the Pipeline
+ */
+class PipelineStageBase {
+public:
+    virtual ~PipelineStageBase() = default;
+    virtual void start(chrono::steady_clock::time_point began) = 0;
+    virtual void join() = 0;
+    virtual StageStats stats() const = 0;
+};
+
+/**
+ * One stage: workers pull batches of In, apply the function, and push
+ * the results (Out) downstream; Out = void makes it a sink
+ * fn is either per element, Out fn(In&) / void fn(In&), or per batch,
+ * void fn(vector<In>& batch, vector<Out>& results) (sinks: fn(batch)).
+ */
+template <typename In, typename Out, typename F>
+class PipelineStage : public PipelineStageBase {
+private:
+    using OutLink = PipeLink<typename conditional<is_void<Out>::value, char, Out>::type>;
+    
+    string name;
+    F fn;
+    StageOptions options;
+    PipeLink<In>& input;
+    OutLink* output;
+    vector<thread> threads;
+    chrono::steady_clock::time_point startedAt;
+    atomic<int64_t> finishedNs{0};
+    atomic<uint64_t> items{0};
+    atomic<uint64_t> batches{0};
+    atomic<int64_t> busyNs{0};
+    atomic<int64_t> inputStallNs{0};
+    atomic<int64_t> outputStallNs{0};
+    
+    static int64_t nanosSince(chrono::steady_clock::time_point t) {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t).count();
+    }
+    
+    /**
+     * Fill batch with up to batchSize elements, lingering for stragglers
+     * Returns false at end of stream
+     */
+    bool gather(vector<In>& batch) {
+        batch.clear();
+        auto waitStart = chrono::steady_clock::now();
+        chrono::steady_clock::time_point deadline;
+        Backoff backoff;
+        while (batch.size() < options.batchSize) {
+            size_t before = batch.size();
+            if (input.try_pop_bulk(batch, options.batchSize - batch.size()) > 0) {
+                if (before == 0) deadline = chrono::steady_clock::now() + options.linger;
+                backoff = Backoff();
+                continue;
+            }
+            if (input.finished()) {
+                // A producer may have published just before finishing
+                if (input.try_pop_bulk(batch, options.batchSize - batch.size()) > 0) continue;
+                break;
+            }
+            if (!batch.empty() && chrono::steady_clock::now() >= deadline) break;
+            backoff.pause();
+        }
+        inputStallNs.fetch_add(nanosSince(waitStart), memory_order_relaxed);
+        return !batch.empty();
+    }
+    
+    void work(int index) {
+        if (options.firstCpu >= 0) {
+            pinCurrentThread(options.firstCpu + index);
+        }
+        vector<In> batch;
+        batch.reserve(options.batchSize);
+        using Result = typename conditional<is_void<Out>::value, char, Out>::type;
+        vector<Result> results;
+        results.reserve(options.batchSize);
+        
+        while (gather(batch)) {
+            auto busyStart = chrono::steady_clock::now();
+            results.clear();
+            if constexpr (is_void<Out>::value) {
+                if constexpr (is_invocable<F&, vector<In>&>::value) {
+                    fn(batch);
+                } else {
+                    for (In& item : batch) fn(item);
+                }
+            } else if constexpr (is_invocable<F&, vector<In>&, vector<Out>&>::value) {
+                fn(batch, results);
+            } else {
+                for (In& item : batch) results.push_back(fn(item));
+            }
+            busyNs.fetch_add(nanosSince(busyStart), memory_order_relaxed);
+            items.fetch_add(batch.size(), memory_order_relaxed);
+            batches.fetch_add(1, memory_order_relaxed);
+            
+            if constexpr (!is_void<Out>::value) {
+                double stalled = output->push_bulk(results.data(), results.size());
+                outputStallNs.fetch_add(static_cast<int64_t>(stalled * 1e9), memory_order_relaxed);
+            }
+        }
+        if constexpr (!is_void<Out>::value) {
+            output->producerDone();
+        }
+        int64_t doneNs = chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - startedAt).count();
+        int64_t previous = finishedNs.load(memory_order_relaxed);
+        while (doneNs > previous &&
+               !finishedNs.compare_exchange_weak(previous, doneNs, memory_order_relaxed)) {
+        }
+    }
+    
+public:
+    PipelineStage(string stageName, F function, const StageOptions& opts,
+                  PipeLink<In>& in, OutLink* out)
+        : name(std::move(stageName)), fn(std::move(function)), options(opts),
+          input(in), output(out) {
+        if (options.batchSize == 0) options.batchSize = 1;
+        if (options.workers < 1) options.workers = 1;
+    }
+    
+    void start(chrono::steady_clock::time_point began) override {
+        startedAt = began;
+        for (int i = 0; i < options.workers; i++) {
+            threads.emplace_back([this, i] { work(i); });
+        }
+    }
+    
+    void join() override {
+        for (thread& t : threads) t.join();
+        threads.clear();
+    }
+    
+    StageStats stats() const override {
+        StageStats s;
+        s.name = name;
+        s.workers = options.workers;
+        s.items = items.load(memory_order_relaxed);
+        s.batches = batches.load(memory_order_relaxed);
+        s.seconds = finishedNs.load(memory_order_relaxed) / 1e9;
+        s.busySeconds = busyNs.load(memory_order_relaxed) / 1e9;
+        s.inputStallSeconds = inputStallNs.load(memory_order_relaxed) / 1e9;
+        s.outputStallSeconds = outputStallNs.load(memory_order_relaxed) / 1e9;
+        return s;
+    }
+};
+
+/**
+ * Chain of stages connected by batched queues
+ *   Pipeline pipe;
+ *   auto& in = pipe.input<Request>();
+ *   auto& parsed = pipe.stage<Request, Parsed>("parse", in, parseFn, opts);
+ *   pipe.sink<Parsed>("store", parsed, storeFn, opts);
+ *   pipe.start();  ... in.push(r) ...  pipe.finish();  pipe.stats();
+ * Stages and links are declared first; start() launches every worker.
+ */
+class Pipeline {
+private:
+    vector<unique_ptr<PipeLinkBase>> links;
+    vector<unique_ptr<PipelineStageBase>> stages;
+    PipeLinkBase* source = nullptr;
+    bool started = false;
+    
+    template <typename T>
+    PipeLink<T>& newLink(int producers) {
+        auto link = make_unique<PipeLink<T>>();
+        link->producers = producers;
+        PipeLink<T>& ref = *link;
+        links.push_back(std::move(link));
+        return ref;
+    }
+    
+    template <typename T>
+    void attachConsumer(PipeLink<T>& link, const StageOptions& options) {
+        if (started) throw runtime_error("Pipeline already started: Cannot add stages");
+        link.consumers += options.workers < 1 ? 1 : options.workers;
+        link.capacity = options.queueCapacity;
+    }
+    
+public:
+    Pipeline() = default;
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    
+    ~Pipeline() {
+        if (started) finish();
+    }
+    
+    /**
+     * Input: The link the caller pushes into (one producer: the caller)
+     */
+    template <typename T>
+    PipeLink<T>& input() {
+        if (source != nullptr) throw runtime_error("Pipeline already has an input");
+        PipeLink<T>& link = newLink<T>(1);
+        source = &link;
+        return link;
+    }
+    
+    /**
+     * Stage: Transform In -> Out; returns the link feeding the next stage
+     */
+    template <typename In, typename Out, typename F>
+    PipeLink<Out>& stage(const string& name, PipeLink<In>& from, F fn,
+                         const StageOptions& options = StageOptions()) {
+        attachConsumer(from, options);
+        PipeLink<Out>& to = newLink<Out>(options.workers < 1 ? 1 : options.workers);
+        stages.push_back(make_unique<PipelineStage<In, Out, F>>(name, std::move(fn), options,
+                                                                from, &to));
+        return to;
+    }
+    
+    /**
+     * Sink: Final stage consuming In
+     */
+    template <typename In, typename F>
+    void sink(const string& name, PipeLink<In>& from, F fn,
+              const StageOptions& options = StageOptions()) {
+        attachConsumer(from, options);
+        stages.push_back(make_unique<PipelineStage<In, void, F>>(name, std::move(fn), options,
+                                                                 from, nullptr));
+    }
+    
+    /**
+     * Start: Create the queues and launch every stage's workers
+     */
+    void start() {
+        if (started) return;
+        for (auto& link : links) link->open();
+        started = true;
+        auto began = chrono::steady_clock::now();
+        for (auto& s : stages) s->start(began);
+    }
+    
+    /**
+     * Finish: Close the input and wait for every stage to drain
+     */
+    void finish() {
+        if (!started) return;
+        started = false;
+        if (source != nullptr) source->producerDone();
+        for (auto& s : stages) s->join();
+    }
+    
+    /**
+     * Stats: One entry per stage, in declaration order
+     */
+    vector<StageStats> stats() const {
+        vector<StageStats> all;
+        for (const auto& s : stages) all.push_back(s->stats());
+        return all;
+    }
+};
+
+// ============================================================================
+// CONCURRENT STACK IMPLEMENTATION (lock-free Treiber stack)
+// ============================================================================
+
+/**
+ * Hazard pointers: safe memory reclamation for lock-free containers
+ * A thread publishes the node it is about to dereference in its hazard
+ * slot. Nodes removed from a container are retired rather than deleted,
+ * and a retired node is only freed once no hazard slot points at it.
+ * Because a protected node can never be freed and reallocated, this also
+ * rules out the ABA problem on the container's head pointer.
+ * Hazard records live in a lock-free list that grows by one record per
+ * concurrently live thread; a thread's record is reused by later threads
+ * once it exits. Nodes a thread still could not free when it exited are
+ * handed to the domain, picked up by the next scan, and freed at program
+ * exit otherwise.
+ */
+class HazardPointers {
+private:
+    static constexpr size_t MIN_SCAN_BATCH = 64;
+    
+    struct alignas(CACHE_LINE_SIZE) Record {
+        atomic<bool> active{true};
+        atomic<void*> hazard{nullptr};
+        Record* next = nullptr;      // Immutable once published
+    };
+    
+    struct Retired {
+        void* pointer;
+        void (*deleter)(void*);
+    };
+    
+    /**
+     * Shared state: every hazard record ever created and the nodes left
+     * behind by exited threads
+     */
+    struct Domain {
+        atomic<Record*> records{nullptr};
+        atomic<size_t> recordCount{0};
+        mutex orphanMutex;
+        vector<Retired> orphans;
+        
+        /**
+         * Runs after every thread_local ThreadState of the main thread;
+         * threads still running at exit must not touch the domain
+         */
+        ~Domain() {
+            for (Retired& item : orphans) item.deleter(item.pointer);
+            Record* r = records.load(memory_order_acquire);
+            while (r != nullptr) {
+                Record* next = r->next;
+                delete r;
+                r = next;
+            }
+        }
+    };
+    
+    static Domain& domain() {
+        static Domain shared;
+        return shared;
+    }
+    
+    /**
+     * Per-thread state: the owned hazard record and the retire list
+     */
+    struct ThreadState {
+        Record* record = nullptr;
+        vector<Retired> retired;
+        
+        ThreadState() {
+            Domain& d = domain();
+            for (Record* r = d.records.load(memory_order_acquire); r != nullptr; r = r->next) {
+                bool expected = false;
+                if (!r->active.load(memory_order_relaxed) &&
+                    r->active.compare_exchange_strong(expected, true)) {
+                    record = r;
+                    return;
+                }
+            }
+            // Every record is taken: add one (created already active)
+            record = new Record();
+            record->next = d.records.load(memory_order_relaxed);
+            while (!d.records.compare_exchange_weak(record->next, record,
+                                                    memory_order_release,
+                                                    memory_order_relaxed)) {}
+            d.recordCount.fetch_add(1, memory_order_relaxed);
+        }
+        
+        ~ThreadState() {
+            record->hazard.store(nullptr);
+            scan(*this);
+            if (!retired.empty()) {
+                // Still protected by another thread: hand over to survivors
+                Domain& d = domain();
+                lock_guard<mutex> lock(d.orphanMutex);
+                d.orphans.insert(d.orphans.end(), retired.begin(), retired.end());
+            }
+            record->active.store(false, memory_order_release);
+        }
+    };
+    
+    static ThreadState& local() {
+        thread_local ThreadState state;
+        return state;
+    }
+    
+    /**
+     * Free every retired node that no thread currently protects
+     */
+    static void scan(ThreadState& state) {
+        Domain& d = domain();
+        {
+            lock_guard<mutex> lock(d.orphanMutex);
+            state.retired.insert(state.retired.end(), d.orphans.begin(), d.orphans.end());
+            d.orphans.clear();
+        }
+        vector<void*> protectedPointers;
+        for (Record* r = d.records.load(memory_order_acquire); r != nullptr; r = r->next) {
+            void* p = r->hazard.load();
+            if (p != nullptr) protectedPointers.push_back(p);
+        }
+        
+        size_t kept = 0;
+        for (Retired& item : state.retired) {
+            bool inUse = false;
+            for (void* p : protectedPointers) {
+                if (p == item.pointer) { inUse = true; break; }
+            }
+            if (inUse) {
+                state.retired[kept++] = item;
+            } else {
+                item.deleter(item.pointer);
+            }
+        }
+        state.retired.resize(kept);
+    }
+    
+public:
+    /**
+     * This thread's hazard slot
+     */
+    static atomic<void*>& slot() {
+        return local().record->hazard;
+    }
+    
+    /**
+     * Retire: Schedule p for deletion once it is no longer protected
+     * Scans once the batch is twice the number of hazard records, so the
+     * amortized cost per node is O(1)
+     */
+    template <typename NodeType>
+    static void retire(NodeType* p) {
+        ThreadState& state = local();
+        state.retired.push_back({p, [](void* q) { delete static_cast<NodeType*>(q); }});
+        size_t threshold = 2 * domain().recordCount.load(memory_order_relaxed);
+        if (state.retired.size() >= (threshold > MIN_SCAN_BATCH ? threshold : MIN_SCAN_BATCH)) {
+            scan(state);
+        }
+    }
+};
+
+/**
+ * Lock-free LIFO stack shared by any number of threads
+ * push and pop are a single CAS on the atomic head; popped nodes are
+ * reclaimed through HazardPointers, so they are never freed while another
+ * thread is still reading them.
+ */
+template <typename T>
+class ConcurrentStack {
+private:
+    struct StackNode {
+        T data;
+        StackNode* next;
+        
+        template <typename... Args>
+        StackNode(Args&&... args) : data(std::forward<Args>(args)...), next(nullptr) {}
+    };
+    
+    alignas(CACHE_LINE_SIZE) atomic<StackNode*> head;
+    
+    /**
+     * Load head and publish it as hazardous until the two agree
+     */
+    StackNode* protectHead(atomic<void*>& hazard) {
+        StackNode* current = head.load();
+        while (true) {
+            hazard.store(current);
+            StackNode* again = head.load();
+            if (again == current) return current;
+            current = again;
+        }
+    }
+    
+public:
+    /**
+     * Constructor: Initialize empty stack
+     */
+    ConcurrentStack() : head(nullptr) {}
+    
+    ConcurrentStack(const ConcurrentStack&) = delete;
+    ConcurrentStack& operator=(const ConcurrentStack&) = delete;
+    
+    /**
+     * Destructor: Free remaining nodes (no thread may still be using it)
+     */
+    ~ConcurrentStack() {
+        StackNode* current = head.load(memory_order_relaxed);
+        while (current != nullptr) {
+            StackNode* next = current->next;
+            delete current;
+            current = next;
+        }
+    }
+    
+    /**
+     * Emplace: Construct element and link it as the new top
+     * Time Complexity: O(1), lock-free
+     */
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        StackNode* node = new StackNode(std::forward<Args>(args)...);
+        node->next = head.load(memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node,
+                                           memory_order_release,
+                                           memory_order_relaxed)) {}
+    }
+    
+    void push(const T& value) {
+        emplace(value);
+    }
+    
+    void push(T&& value) {
+        emplace(std::move(value));
+    }
+    
+    /**
+     * Try pop: Move top element into out if the stack is non-empty
+     * Time Complexity: O(1), lock-free
+     */
+    bool try_pop(T& out) {
+        atomic<void*>& hazard = HazardPointers::slot();
+        StackNode* top;
+        while (true) {
+            top = protectHead(hazard);
+            if (top == nullptr) break;
+            // top cannot be freed while protected, so reading next is safe
+            if (head.compare_exchange_strong(top, top->next)) break;
+        }
+        hazard.store(nullptr);
+        if (top == nullptr) {
+            return false;
+        }
+        out = std::move(top->data);
+        HazardPointers::retire(top);
+        return true;
+    }
+    
+    /**
+     * Pop all: Detach the whole stack with one atomic exchange
+     * Elements are written to out in LIFO order; returns how many
+     * Time Complexity: O(n) for the copy-out, O(1) contention
+     */
+    template <typename OutputIt>
+    size_t pop_all(OutputIt out) {
+        StackNode* current = head.exchange(nullptr, memory_order_acquire);
+        size_t n = 0;
+        while (current != nullptr) {
+            StackNode* next = current->next;
+            *out = std::move(current->data);
+            ++out;
+            // A concurrent try_pop may still hold current as its hazard
+            HazardPointers::retire(current);
+            current = next;
+            n++;
+        }
+        return n;
+    }
+    
+    /**
+     * Check if stack is (momentarily) empty
+     */
+    bool isEmpty() const {
+        return head.load(memory_order_acquire) == nullptr;
+    }
+};
+
+// ============================================================================
+// WORK-STEALING DEQUE AND TASK SCHEDULER
+// ============================================================================
+
+/**
+ * Chase-Lev work-stealing deque (the C11 formulation by Le et al.)
+ * The owning thread pushes and pops at the bottom like a Stack (LIFO, so
+ * it works on the freshest, cache-hot task); any other thread may steal
+ * from the top like a Queue (FIFO, so thieves take the oldest and usually
+ * largest piece of work). Only steals and the owner's last-element pop
+ * contend, and they resolve with a single CAS on top.
+ * T must be trivially copyable (typically a pointer): a thief may read a
+ * slot that the owner overwrites, and the CAS then discards the read.
+ */
+template <typename T>
+class WorkStealingDeque {
+private:
+    static_assert(is_trivially_copyable<T>::value,
+                  "WorkStealingDeque elements must be trivially copyable");
+    
+    /**
+     * Circular array of atomic slots; replaced (never resized) on growth
+     */
+    struct Array {
+        int64_t capacity;
+        int64_t mask;
+        unique_ptr<atomic<T>[]> slots;
+        
+        explicit Array(int64_t cap) : capacity(cap), mask(cap - 1), slots(new atomic<T>[cap]) {}
+        
+        T get(int64_t i) const {
+            return slots[i & mask].load(memory_order_relaxed);
+        }
+        
+        void put(int64_t i, T value) {
+            slots[i & mask].store(value, memory_order_relaxed);
+        }
+    };
+    
+    alignas(CACHE_LINE_SIZE) atomic<int64_t> top;      // Thieves' end
+    alignas(CACHE_LINE_SIZE) atomic<int64_t> bottom;   // Owner's end
+    alignas(CACHE_LINE_SIZE) atomic<Array*> array;
+    vector<unique_ptr<Array>> retiredArrays;  // Thieves may still read these
+    
+    /**
+     * Grow (owner only): Copy live slots into an array twice the size
+     */
+    Array* grow(Array* old, int64_t t, int64_t b) {
+        Array* bigger = new Array(old->capacity * 2);
+        for (int64_t i = t; i < b; i++) {
+            bigger->put(i, old->get(i));
+        }
+        retiredArrays.emplace_back(old);
+        array.store(bigger, memory_order_release);
+        return bigger;
+    }
+    
+public:
+    /**
+     * Constructor: Initialize empty deque (capacity rounded up to 2^k)
+     */
+    explicit WorkStealingDeque(int64_t initialCapacity = 256) : top(0), bottom(0) {
+        int64_t cap = 2;
+        while (cap < initialCapacity) cap <<= 1;
+        array.store(new Array(cap), memory_order_relaxed);
+    }
+    
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+    
+    ~WorkStealingDeque() {
+        delete array.load(memory_order_relaxed);
+    }
+    
+    /**
+     * Push (owner only): Add element at the bottom
+     * Time Complexity: O(1) amortized, no atomic read-modify-write
+     */
+    void push(T value) {
+        int64_t b = bottom.load(memory_order_relaxed);
+        int64_t t = top.load(memory_order_acquire);
+        Array* a = array.load(memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, value);
+        atomic_thread_fence(memory_order_release);
+        bottom.store(b + 1, memory_order_relaxed);
+    }
+    
+    /**
+     * Pop (owner only): Remove the most recently pushed element
+     * Returns false if the deque is empty or a thief won the last element
+     */
+    bool pop(T& out) {
+        int64_t b = bottom.load(memory_order_relaxed) - 1;
+        Array* a = array.load(memory_order_relaxed);
+        bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t t = top.load(memory_order_relaxed);
+        
+        if (t > b) {
+            bottom.store(b + 1, memory_order_relaxed);  // Was empty
+            return false;
+        }
+        out = a->get(b);
+        if (t == b) {
+            // Last element: race thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, memory_order_seq_cst,
+                                                   memory_order_relaxed);
+            bottom.store(b + 1, memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+    
+    /**
+     * Steal (any thread): Remove the oldest element
+     * Returns false if the deque is empty or another thread got there first
+     */
+    bool steal(T& out) {
+        int64_t t = top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t b = bottom.load(memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        Array* a = array.load(memory_order_acquire);
+        T value = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst,
+                                         memory_order_relaxed)) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+    
+    /**
+     * Approximate number of elements
+     */
+    int64_t size() const {
+        int64_t b = bottom.load(memory_order_relaxed);
+        int64_t t = top.load(memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+    
+    /**
+     * Check if deque is (approximately) empty
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+};
+
+class TaskScheduler;
+
+/**
+ * Set of tasks that can be waited on together (fork/join)
+ * wait() does not block: the waiting thread runs queued tasks itself until
+ * the group finishes, so nested groups inside tasks cannot deadlock.
+ * The first exception thrown by a task is rethrown from wait(); the
+ * destructor waits too, so queued tasks never outlive their group.
+ */
+class TaskGroup {
+private:
+    TaskScheduler& scheduler;
+    atomic<long> pending;
+    mutex errorLock;
+    exception_ptr error;     // First exception thrown by a task
+    
+    friend class TaskScheduler;
+    
+    void recordError(exception_ptr e) {
+        lock_guard<mutex> lock(errorLock);
+        if (!error) error = std::move(e);
+    }
+    
+public:
+    explicit TaskGroup(TaskScheduler& owner) : scheduler(owner), pending(0) {}
+    
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    
+    ~TaskGroup();
+    
+    template <typename F>
+    void run(F&& fn);
+    
+    void wait();
+};
+
+/**
+ * Thread pool with one work-stealing deque per worker
+ * Tasks spawned from a worker go to that worker's own deque; tasks from
+ * any other thread go through a shared bounded MpmcQueue. An idle worker
+ * checks its deque, then the shared queue, then steals from a randomly
+ * chosen victim.
+ */
+class TaskScheduler {
+private:
+    struct Task {
+        function<void()> fn;
+        TaskGroup* group;
+    };
+    
+    /**
+     * Identifies the scheduler and deque owned by the current thread
+     */
+    struct WorkerContext {
+        TaskScheduler* scheduler = nullptr;
+        unsigned index = 0;
+        uint64_t rng = 0;    // xorshift state for victim selection
+    };
+    
+    vector<unique_ptr<WorkStealingDeque<Task*>>> deques;
+    MpmcQueue<Task*> injected;
+    vector<thread> workers;
+    atomic<bool> stopping;
+    
+    static WorkerContext& context() {
+        thread_local WorkerContext ctx;
+        return ctx;
+    }
+    
+    /**
+     * Run a task, catching its exception for the group; the task is freed
+     * before pending drops, since the group may be gone right after
+     */
+    void execute(Task* task) {
+        TaskGroup* group = task->group;
+        try {
+            task->fn();
+        } catch (...) {
+            group->recordError(current_exception());
+        }
+        delete task;
+        group->pending.fetch_sub(1, memory_order_release);
+    }
+    
+    /**
+     * Find one task (own deque, shared queue, then victims) and run it
+     */
+    bool runOne() {
+        WorkerContext& ctx = context();
+        Task* task = nullptr;
+        bool isWorker = ctx.scheduler == this;
+        
+        if (isWorker && deques[ctx.index]->pop(task)) {
+            execute(task);
+            return true;
+        }
+        if (injected.try_dequeue(task)) {
+            execute(task);
+            return true;
+        }
+        
+        size_t n = deques.size();
+        uint64_t& rng = ctx.rng;
+        if (rng == 0) rng = reinterpret_cast<uintptr_t>(&ctx) | 1;
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        size_t start = static_cast<size_t>(rng % n);
+        for (size_t k = 0; k < n; k++) {
+            size_t victim = (start + k) % n;
+            if (isWorker && victim == ctx.index) continue;
+            if (deques[victim]->steal(task)) {
+                execute(task);
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void workerLoop(unsigned index) {
+        WorkerContext& ctx = context();
+        ctx.scheduler = this;
+        ctx.index = index;
+        Backoff backoff;
+        while (true) {
+            if (runOne()) {
+                backoff = Backoff();
+            } else if (stopping.load(memory_order_acquire)) {
+                break;
+            } else {
+                backoff.pause();
+            }
+        }
+    }
+    
+    friend class TaskGroup;
+    
+    void spawn(TaskGroup& group, function<void()> fn) {
+        Task* task = new Task{std::move(fn), &group};
+        group.pending.fetch_add(1, memory_order_relaxed);
+        WorkerContext& ctx = context();
+        if (ctx.scheduler == this) {
+            deques[ctx.index]->push(task);
+        } else {
+            injected.enqueue(task);  // Waits if the shared queue is full
+        }
+    }
+    
+    void wait(TaskGroup& group) {
+        Backoff backoff;
+        while (group.pending.load(memory_order_acquire) > 0) {
+            if (runOne()) {
+                backoff = Backoff();
+            } else {
+                backoff.pause();
+            }
+        }
+    }
+    
+public:
+    /**
+     * Constructor: Start threadCount workers (default: one per core)
+     */
+    explicit TaskScheduler(unsigned threadCount = thread::hardware_concurrency())
+        : injected(4096), stopping(false) {
+        if (threadCount == 0) threadCount = 1;
+        for (unsigned i = 0; i < threadCount; i++) {
+            deques.emplace_back(new WorkStealingDeque<Task*>());
+        }
+        for (unsigned i = 0; i < threadCount; i++) {
+            workers.emplace_back(&TaskScheduler::workerLoop, this, i);
+        }
+    }
+    
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    
+    /**
+     * Destructor: Let workers finish queued tasks, then join them
+     */
+    ~TaskScheduler() {
+        stopping.store(true, memory_order_release);
+        for (thread& t : workers) {
+            t.join();
+        }
+    }
+    
+    /**
+     * Get number of worker threads
+     */
+    unsigned workerCount() const {
+        return static_cast<unsigned>(workers.size());
+    }
+};
+
+template <typename F>
+void TaskGroup::run(F&& fn) {
+    scheduler.spawn(*this, function<void()>(std::forward<F>(fn)));
+}
+
+inline TaskGroup::~TaskGroup() {
+    scheduler.wait(*this);
+}
+
+inline void TaskGroup::wait() {
+    scheduler.wait(*this);
+    exception_ptr first;
+    {
+        lock_guard<mutex> lock(errorLock);
+        first = std::move(error);
+        error = nullptr;
+    }
+    if (first) rethrow_exception(first);
+}
+
+// ============================================================================
+// PARALLEL BFS (level-synchronous, direction-optimizing)
+// ============================================================================
+
+/**
+ * Graph in compressed sparse row form
+ * The neighbours of v are neighbors[offsets[v] .. offsets[v + 1]).
+ */
+struct CsrGraph {
+    vector<int64_t> offsets;     // vertexCount() + 1 entries
+    vector<int32_t> neighbors;   // edgeCount() entries
+    
+    int32_t vertexCount() const {
+        return offsets.empty() ? 0 : static_cast<int32_t>(offsets.size() - 1);
+    }
+    
+    int64_t edgeCount() const {
+        return static_cast<int64_t>(neighbors.size());
+    }
+    
+    int64_t degree(int32_t v) const {
+        return offsets[v + 1] - offsets[v];
+    }
+    
+    /**
+     * Build from an edge list; undirected graphs store both directions
+     * Throws out_of_range if an endpoint is not in [0, vertexCount)
+     */
+    static CsrGraph fromEdges(int32_t vertexCount, const vector<pair<int32_t, int32_t>>& edges,
+                              bool undirected) {
+        if (vertexCount < 0) {
+            throw out_of_range("CsrGraph: negative vertex count");
+        }
+        for (const auto& e : edges) {
+            if (e.first < 0 || e.first >= vertexCount || e.second < 0 || e.second >= vertexCount) {
+                throw out_of_range("CsrGraph: edge (" + to_string(e.first) + ", " +
+                                   to_string(e.second) + ") outside [0, " +
+                                   to_string(vertexCount) + ")");
+            }
+        }
+        CsrGraph g;
+        g.offsets.assign(vertexCount + 1, 0);
+        for (const auto& e : edges) {
+            g.offsets[e.first + 1]++;
+            if (undirected) g.offsets[e.second + 1]++;
+        }
+        for (int32_t v = 0; v < vertexCount; v++) {
+            g.offsets[v + 1] += g.offsets[v];
+        }
+        g.neighbors.resize(g.offsets[vertexCount]);
+        vector<int64_t> cursor(g.offsets.begin(), g.offsets.end() - 1);
+        for (const auto& e : edges) {
+            g.neighbors[cursor[e.first]++] = e.second;
+            if (undirected) g.neighbors[cursor[e.second]++] = e.first;
+        }
+        return g;
+    }
+    
+    /**
+     * Reverse every edge (needed for bottom-up steps on directed graphs)
+     */
+    CsrGraph transposed() const {
+        vector<pair<int32_t, int32_t>> reversed;
+        reversed.reserve(neighbors.size());
+        for (int32_t v = 0; v < vertexCount(); v++) {
+            for (int64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                reversed.emplace_back(neighbors[i], v);
+            }
+        }
+        return fromEdges(vertexCount(), reversed, false);
+    }
+};
+
+/**
+ * Index of the lowest set bit of a non-zero word
+ */
+inline int lowestSetBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int index = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+/**
+ * Parallel breadth-first search over a CsrGraph (Beamer et al.)
+ * Each level is split into chunks run as TaskScheduler tasks.
+ * - Top-down steps scan the contiguous frontier array and claim newly
+ *   reached vertices with an atomic OR on the visited bitmap.
+ * - Bottom-up steps let every unvisited vertex look for any parent in
+ *   the frontier bitmap, which is far cheaper once the frontier is large.
+ * The search switches to bottom-up when the frontier's edges exceed
+ * 1/ALPHA of the unexplored edges, and back once the frontier shrinks
+ * below 1/BETA of the vertices.
+ */
+class ParallelBfs {
+private:
+    static constexpr int64_t ALPHA = 14;
+    static constexpr int64_t BETA = 24;
+    static constexpr size_t TOP_DOWN_CHUNK = 1024;      // Frontier vertices per task
+    static constexpr int32_t BOTTOM_UP_CHUNK = 64 * 256; // Vertices per task (whole words)
+    
+    TaskScheduler& scheduler;
+    
+    static bool testBit(const vector<atomic<uint64_t>>& bits, int32_t v) {
+        return (bits[v >> 6].load(memory_order_relaxed) >> (v & 63)) & 1;
+    }
+    
+    /**
+     * Top-down step: expand every frontier vertex's out-edges
+     */
+    void topDownStep(const CsrGraph& graph, const vector<int32_t>& frontier,
+                     vector<int32_t>& next, vector<atomic<uint64_t>>& visited,
+                     vector<int32_t>& depth, int32_t level) {
+        size_t chunks = (frontier.size() + TOP_DOWN_CHUNK - 1) / TOP_DOWN_CHUNK;
+        vector<vector<int32_t>> found(chunks);
+        TaskGroup group(scheduler);
+        for (size_t c = 0; c < chunks; c++) {
+            group.run([&, c]() {
+                size_t begin = c * TOP_DOWN_CHUNK;
+                size_t end = begin + TOP_DOWN_CHUNK < frontier.size() ? begin + TOP_DOWN_CHUNK
+                                                                      : frontier.size();
+                vector<int32_t>& out = found[c];
+                for (size_t i = begin; i < end; i++) {
+                    int32_t u = frontier[i];
+                    for (int64_t e = graph.offsets[u]; e < graph.offsets[u + 1]; e++) {
+                        int32_t v = graph.neighbors[e];
+                        uint64_t bit = 1ull << (v & 63);
+                        if (visited[v >> 6].load(memory_order_relaxed) & bit) continue;
+                        if (!(visited[v >> 6].fetch_or(bit, memory_order_relaxed) & bit)) {
+                            depth[v] = level + 1;
+                            out.push_back(v);
+                        }
+                    }
+                }
+            });
+        }
+        group.wait();
+        
+        next.clear();
+        for (const vector<int32_t>& part : found) {
+            next.insert(next.end(), part.begin(), part.end());
+        }
+    }
+    
+    /**
+     * Bottom-up step: each unvisited vertex checks its in-edges for a
+     * parent in the current frontier and stops at the first one
+     * Returns the number of vertices discovered
+     */
+    int64_t bottomUpStep(const CsrGraph& incoming, const vector<atomic<uint64_t>>& frontierBits,
+                         vector<atomic<uint64_t>>& nextBits, vector<atomic<uint64_t>>& visited,
+                         vector<int32_t>& depth, int32_t level) {
+        int32_t n = incoming.vertexCount();
+        atomic<int64_t> discovered(0);
+        TaskGroup group(scheduler);
+        for (int32_t begin = 0; begin < n; begin += BOTTOM_UP_CHUNK) {
+            group.run([&, begin]() {
+                int32_t end = begin + BOTTOM_UP_CHUNK < n ? begin + BOTTOM_UP_CHUNK : n;
+                int64_t local = 0;
+                // Chunks cover whole bitmap words, so each word has one writer
+                for (int32_t w = begin >> 6; w <= (end - 1) >> 6; w++) {
+                    uint64_t seen = visited[w].load(memory_order_relaxed);
+                    uint64_t added = 0;
+                    for (int b = 0; b < 64; b++) {
+                        int32_t v = (w << 6) + b;
+                        if (v >= end) break;
+                        if ((seen >> b) & 1) continue;
+                        for (int64_t e = incoming.offsets[v]; e < incoming.offsets[v + 1]; e++) {
+                            if (testBit(frontierBits, incoming.neighbors[e])) {
+                                depth[v] = level + 1;
+                                added |= 1ull << b;
+                                local++;
+                                break;
+                            }
+                        }
+                    }
+                    visited[w].store(seen | added, memory_order_relaxed);
+                    nextBits[w].store(added, memory_order_relaxed);
+                }
+                discovered.fetch_add(local, memory_order_relaxed);
+            });
+        }
+        group.wait();
+        return discovered.load();
+    }
+    
+public:
+    explicit ParallelBfs(TaskScheduler& taskScheduler) : scheduler(taskScheduler) {}
+    
+    /**
+     * Run BFS from source and return each vertex's depth (-1 if unreachable)
+     * incoming must be graph.transposed() for directed graphs; pass
+     * nullptr for undirected graphs, whose CSR is already symmetric.
+     * Throws out_of_range if source is not a vertex of graph.
+     */
+    vector<int32_t> run(const CsrGraph& graph, int32_t source,
+                        const CsrGraph* incoming = nullptr) {
+        if (incoming == nullptr) incoming = &graph;
+        int32_t n = graph.vertexCount();
+        if (source < 0 || source >= n) {
+            throw out_of_range("ParallelBfs: source vertex " + to_string(source) +
+                               " outside [0, " + to_string(n) + ")");
+        }
+        if (incoming->vertexCount() != n) {
+            throw out_of_range("ParallelBfs: incoming graph has a different vertex count");
+        }
+        size_t words = (static_cast<size_t>(n) + 63) / 64;
+        vector<int32_t> depth(n, -1);
+        vector<atomic<uint64_t>> visited(words);
+        vector<atomic<uint64_t>> frontierBits(words);
+        vector<atomic<uint64_t>> nextBits(words);
+        for (size_t w = 0; w < words; w++) {
+            visited[w].store(0, memory_order_relaxed);
+            frontierBits[w].store(0, memory_order_relaxed);
+        }
+        
+        vector<int32_t> frontier{source};
+        vector<int32_t> next;
+        visited[source >> 6].store(1ull << (source & 63), memory_order_relaxed);
+        depth[source] = 0;
+        
+        int64_t unexploredEdges = graph.edgeCount();
+        int64_t frontierSize = 1;
+        bool bottomUp = false;
+        for (int32_t level = 0; frontierSize > 0; level++) {
+            if (!bottomUp) {
+                int64_t frontierEdges = 0;
+                for (int32_t u : frontier) frontierEdges += graph.degree(u);
+                unexploredEdges -= frontierEdges;
+                
+                if (frontierEdges > unexploredEdges / ALPHA) {
+                    // Switch: turn the frontier array into a bitmap
+                    bottomUp = true;
+                    for (size_t w = 0; w < words; w++) frontierBits[w].store(0, memory_order_relaxed);
+                    for (int32_t u : frontier) {
+                        frontierBits[u >> 6].fetch_or(1ull << (u & 63), memory_order_relaxed);
+                    }
+                } else {
+                    topDownStep(graph, frontier, next, visited, depth, level);
+                    frontier.swap(next);
+                    frontierSize = static_cast<int64_t>(frontier.size());
+                    continue;
+                }
+            }
+            
+            frontierSize = bottomUpStep(*incoming, frontierBits, nextBits, visited, depth, level);
+            frontierBits.swap(nextBits);
+            
+            if (frontierSize > 0 && frontierSize < n / BETA) {
+                // Switch back: turn the frontier bitmap into an array
+                bottomUp = false;
+                frontier.clear();
+                for (size_t w = 0; w < words; w++) {
+                    uint64_t bits = frontierBits[w].load(memory_order_relaxed);
+                    while (bits) {
+                        frontier.push_back(static_cast<int32_t>(w * 64 + lowestSetBit(bits)));
+                        bits &= bits - 1;
+                    }
+                }
+            }
+        }
+        return depth;
+    }
+};
+
+// ============================================================================
+// DEMONSTRATION AND USE CASES
+// ============================================================================
+
+/**
+ * Demonstrate stack operations
+ */
+void demonstrateStack() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "STACK DEMONSTRATION (LIFO)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    Stack<int, ConsoleTrace> intStack(5);
+    
+    // Push elements
+    cout << "\n--- Pushing elements ---" << endl;
+    intStack.push(10);
+    intStack.push(20);
+    intStack.push(30);
+    intStack.push(40);
+    intStack.push(50);
+    intStack.display();
+    
+    // Peek at top
+    cout << "\n--- Peek operation ---" << endl;
+    cout << "Top element: " << intStack.peek() << endl;
+    
+    // Pop elements
+    cout << "\n--- Popping elements ---" << endl;
+    intStack.pop();
+    intStack.pop();
+    intStack.display();
+    cout << "Current size: " << intStack.size() << endl;
+    
+    // Test resize
+    cout << "\n--- Testing dynamic resize ---" << endl;
+    intStack.push(60);
+    intStack.push(70);
+    intStack.push(80);  // This should trigger resize
+    intStack.display();
+    
+    // String stack example
+    cout << "\n--- String Stack Example ---" << endl;
+    Stack<string, ConsoleTrace> strStack(3);
+    strStack.push("Hello");
+    strStack.push("World");
+    strStack.push("!");
+    strStack.display();
+    
+    // Construct in place and move out without copying
+    cout << "\n--- Emplace and move-out pop ---" << endl;
+    strStack.emplace(3, '?');  // Builds "???" directly in the stack
+    string word;
+    strStack.pop(word);        // Moves into word, reusing its buffer
+    strStack.display();
+    
+    // Save and restore an undo history through a binary snapshot
+    cout << "\n--- Snapshot and restore ---" << endl;
+    stringstream snapshot;
+    strStack.serialize(snapshot);
+    Stack<string, ConsoleTrace> restored(2);
+    restored.deserialize(snapshot);
+    restored.display();
+    
+    // Bracket matching on a stack that never leaves the inline buffer
+    cout << "\n--- Small-buffer stack (no heap allocation) ---" << endl;
+    string expression = "{[(a+b)*(c-d)]/e}";
+    SmallStack<char, 16> brackets(16);
+    bool balanced = true;
+    for (char ch : expression) {
+        if (ch == '(' || ch == '[' || ch == '{') {
+            brackets.push(ch);
+        } else if (ch == ')' || ch == ']' || ch == '}') {
+            char open = ch == ')' ? '(' : ch == ']' ? '[' : '{';
+            if (brackets.isEmpty() || brackets.pop() != open) {
+                balanced = false;
+                break;
+            }
+        }
+    }
+    balanced = balanced && brackets.isEmpty();
+    cout << expression << " is " << (balanced ? "balanced" : "not balanced") << endl;
+    
+    // Growth policy with automatic shrinking after a spike
+    cout << "\n--- Growth policy and shrinking ---" << endl;
+    Stack<int, NoTrace, 0, allocator<int>, HysteresisShrink<HalfAgainGrowth>> spiky(16);
+    for (int i = 0; i < 100000; i++) spiky.push(i);
+    cout << "After 100000 pushes, capacity: " << spiky.getCapacity() << endl;
+    while (spiky.size() > 100) spiky.pop();
+    cout << "After popping to 100, capacity: " << spiky.getCapacity() << endl;
+    spiky.shrink_to_fit();
+    cout << "After shrink_to_fit, capacity: " << spiky.getCapacity() << endl;
+}
+
+/**
+ * Demonstrate queue operations
+ */
+void demonstrateQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "QUEUE DEMONSTRATION (FIFO)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    Queue<int, ConsoleTrace> intQueue;
+    
+    // Enqueue elements
+    cout << "\n--- Enqueuing elements ---" << endl;
+    intQueue.enqueue(100);
+    intQueue.enqueue(200);
+    intQueue.enqueue(300);
+    intQueue.enqueue(400);
+    intQueue.display();
+    
+    // Front element
+    cout << "\n--- Front operation ---" << endl;
+    cout << "Front element: " << intQueue.front() << endl;
+    
+    // Dequeue elements
+    cout << "\n--- Dequeuing elements ---" << endl;
+    intQueue.dequeue();
+    intQueue.dequeue();
+    intQueue.display();
+    cout << "Current size: " << intQueue.size() << endl;
+    
+    // Add more elements
+    cout << "\n--- Adding more elements ---" << endl;
+    intQueue.enqueue(500);
+    intQueue.enqueue(600);
+    intQueue.display();
+    
+    // String queue example
+    cout << "\n--- String Queue Example ---" << endl;
+    Queue<string, ConsoleTrace> strQueue;
+    strQueue.enqueue("First");
+    strQueue.enqueue("Second");
+    strQueue.enqueue("Third");
+    strQueue.display();
+    strQueue.dequeue();
+    strQueue.display();
+    
+    // Two queues recycling nodes from one caller-owned arena
+    cout << "\n--- Pooled nodes from a shared arena ---" << endl;
+    NodePool<Node<int>> arena;
+    Queue<int, NoTrace, ArenaNodeAllocator> jobs{ArenaNodeAllocator<Node<int>>(arena)};
+    Queue<int, NoTrace, ArenaNodeAllocator> retries{ArenaNodeAllocator<Node<int>>(arena)};
+    for (int round = 0; round < 1000; round++) {
+        jobs.enqueue(round);
+        retries.enqueue(jobs.dequeue());
+        retries.dequeue();
+    }
+    cout << "1000 rounds through two queues used " << arena.chunkCount()
+         << " chunk(s) of " << NodePool<Node<int>>::NODES_PER_CHUNK << " nodes" << endl;
+}
+
+/**
+ * Demonstrate ring queue operations, including wrap-around and growth
+ */
+void demonstrateRingQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "RING QUEUE DEMONSTRATION (FIFO, CONTIGUOUS)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    RingQueue<int, ConsoleTrace> ringQueue(4);
+    
+    // Fill, drain partially, and refill so indices wrap around
+    cout << "\n--- Wrap-around ---" << endl;
+    ringQueue.enqueue(1);
+    ringQueue.enqueue(2);
+    ringQueue.enqueue(3);
+    ringQueue.dequeue();
+    ringQueue.dequeue();
+    ringQueue.enqueue(4);
+    ringQueue.enqueue(5);
+    ringQueue.enqueue(6);
+    ringQueue.display();
+    
+    // Exceed capacity to trigger growth
+    cout << "\n--- Testing growth ---" << endl;
+    ringQueue.enqueue(7);
+    ringQueue.display();
+    cout << "Front element: " << ringQueue.front() << endl;
+    cout << "Current size: " << ringQueue.size()
+         << ", capacity: " << ringQueue.getCapacity() << endl;
+    
+    // Batch ingest: one capacity check and a memcpy per contiguous run
+    cout << "\n--- Bulk enqueue/dequeue ---" << endl;
+    int batch[] = {8, 9, 10, 11, 12, 13};
+    ringQueue.enqueue_range(batch, batch + 6);
+    int drained[4];
+    size_t n = ringQueue.dequeue_n(drained, 4);
+    cout << "Dequeued " << n << " starting at " << drained[0] << endl;
+    ringQueue.display();
+}
+
+/**
+ * Demonstrate the chunked queue growing across several blocks
+ */
+void demonstrateChunkedQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "CHUNKED QUEUE DEMONSTRATION (FIFO, LINKED BLOCKS)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    ChunkedQueue<int> chunked;
+    const int itemCount = 5000;
+    for (int i = 1; i <= itemCount; i++) {
+        chunked.enqueue(i);
+    }
+    cout << "Enqueued " << itemCount << " ints into blocks of "
+         << ChunkedQueue<int>::BLOCK_ELEMENTS << " elements" << endl;
+    
+    long long sum = 0;
+    chunked.forEach([&](int value) { sum += value; });
+    cout << "Sequential forEach sum: " << sum << endl;
+    
+    for (int i = 0; i < itemCount - 3; i++) {
+        chunked.dequeue();
+    }
+    chunked.display();
+}
+
+/**
+ * Message living in a caller-owned pool, linkable without allocation
+ */
+struct PooledMessage : IntrusiveHook<> {
+    int id = 0;
+    char payload[48] = {};
+};
+
+/**
+ * Demonstrate the intrusive queue and stack
+ */
+void demonstrateIntrusiveContainers() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "INTRUSIVE QUEUE AND STACK DEMONSTRATION" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    PooledMessage pool[6];
+    for (int i = 0; i < 6; i++) pool[i].id = i + 1;
+    
+    // Two connections queue messages; the dispatcher takes both in O(1)
+    IntrusiveQueue<PooledMessage> connectionA;
+    IntrusiveQueue<PooledMessage> connectionB;
+    for (int i = 0; i < 3; i++) connectionA.enqueue(pool[i]);
+    for (int i = 3; i < 6; i++) connectionB.enqueue(pool[i]);
+    
+    IntrusiveQueue<PooledMessage> dispatch;
+    dispatch.splice(connectionA);
+    dispatch.splice(connectionB);
+    cout << "Dispatch queue after two splices (" << dispatch.size() << "):";
+    dispatch.forEach([](const PooledMessage& m) { cout << " " << m.id; });
+    cout << " | sources empty: " << boolalpha << (connectionA.isEmpty() && connectionB.isEmpty())
+         << noboolalpha << endl;
+    
+    // Processed messages go back to a free stack, same objects, no copies
+    IntrusiveStack<PooledMessage> freeList;
+    while (PooledMessage* m = dispatch.try_dequeue()) {
+        freeList.push(*m);
+    }
+    PooledMessage& reused = freeList.pop();
+    cout << "Reused message " << reused.id << " from pool slot "
+         << (&reused - pool) << " (no allocation)" << endl;
+}
+
+/**
+ * Demonstrate persistent containers as cheap snapshots (undo history)
+ */
+void demonstratePersistentContainers() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "PERSISTENT STACK AND QUEUE DEMONSTRATION" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    // Every edit is a new version; undo is just picking an older one
+    vector<PersistentStack<string>> history(1);
+    for (const char* word : {"the", "quick", "brown", "fox"}) {
+        history.push_back(history.back().push(word));
+    }
+    history.back().display();
+    PersistentStack<string> undone = history.back().pop();
+    cout << "Undo shares the earlier version: " << boolalpha
+         << undone.sharesWith(history[3]) << noboolalpha
+         << " (top '" << undone.top() << "', size " << undone.size() << ")" << endl;
+    PersistentStack<string> branch = undone.push("lazy");
+    cout << "Branch after undo: ";
+    branch.forEach([](const string& word) { cout << word << " "; });
+    cout << "| original still ends in '" << history.back().top() << "'" << endl;
+    
+    // A queue snapshot is unaffected by later work on the live version
+    PersistentQueue<int> live;
+    for (int job = 1; job <= 5; job++) live = live.enqueue(job);
+    PersistentQueue<int> snapshot = live;
+    live = live.dequeue().dequeue().enqueue(6);
+    live.display();
+    snapshot.display();
+    
+    // Re-reading an old snapshot stays O(1): the rotation is memoized
+    PersistentQueue<int> replayA = snapshot.dequeue();
+    PersistentQueue<int> replayB = snapshot.dequeue();
+    cout << "Two replays of one snapshot: front " << replayA.getFront() << " and "
+         << replayB.getFront() << endl;
+    
+    // Keeping every version of a long run costs one cell per operation
+    const int versions = 100000;
+    vector<PersistentQueue<int>> timeline;
+    timeline.reserve(versions);
+    PersistentQueue<int> q;
+    for (int i = 0; i < versions; i++) {
+        q = (i % 3 == 2) ? q.dequeue() : q.enqueue(i);
+        timeline.push_back(q);
+    }
+    cout << "Kept " << timeline.size() << " queue versions; newest front " << q.getFront()
+         << ", size " << q.size() << "; version 299 front " << timeline[299].getFront() << endl;
+}
+
+/**
+ * Demonstrate the priority queue and sliding-window monotonic queue
+ */
+void demonstratePriorityQueues() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "PRIORITY QUEUE AND MONOTONIC QUEUE DEMONSTRATION" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    // Scheduler: lower number runs first; one task gets bumped up
+    cout << "--- 4-ary heap with decrease_key ---" << endl;
+    DaryHeap<pair<int, string>> tasks;
+    tasks.push({30, "backup"});
+    auto report = tasks.push({50, "report"});
+    tasks.push({10, "request"});
+    tasks.push({40, "cleanup"});
+    tasks.decrease_key(report, {5, "report (urgent)"});
+    cout << "Run order:";
+    while (!tasks.isEmpty()) {
+        cout << " " << tasks.pop().second;
+    }
+    cout << endl;
+    
+    // Sliding-window maximum over a stream, window of 3
+    cout << "\n--- Sliding-window maximum (window 3) ---" << endl;
+    int stream[] = {1, 3, -1, -3, 5, 3, 6, 7};
+    MonotonicQueue<int, greater<int>> window;
+    cout << "Maxima:";
+    for (int i = 0; i < 8; i++) {
+        window.push(stream[i]);
+        if (window.size() > 3) window.pop();
+        if (i >= 2) cout << " " << window.best();
+    }
+    cout << endl;
+}
+
+/**
+ * Demonstrate search and reductions over container contents
+ */
+void demonstrateSearch() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "SEARCH AND REDUCTION DEMONSTRATION (" << STACK_QUEUE_SIMD << " kernels)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    Stack<int> stack;
+    for (int i = 1; i <= 100; i++) stack.push(i % 7 == 0 ? 7 : i);
+    cout << "Stack of 100: contains(42)=" << boolalpha << stack.contains(42)
+         << ", count(7)=" << stack.count(7) << ", find(99)=" << stack.find(99)
+         << " from top" << endl;
+    cout << "min=" << stack.min() << ", max=" << stack.max() << ", sum=" << stack.sum() << endl;
+    
+    // Window over a ring that has wrapped around
+    RingQueue<int> window(8);
+    for (int i = 0; i < 20; i++) {
+        window.enqueue(i * 3 % 17);
+        if (window.size() > 6) window.dequeue();
+    }
+    cout << "\nRing window: ";
+    window.display();
+    cout << "min=" << window.min() << ", max=" << window.max() << ", sum=" << window.sum()
+         << ", find(11)=" << window.find(11) << " from front" << endl;
+    
+    Queue<string> names;
+    names.enqueue("ada");
+    names.enqueue("grace");
+    names.enqueue("alan");
+    cout << "\nLinked queue (scalar only): contains(\"grace\")=" << names.contains("grace")
+         << ", max=" << names.max() << noboolalpha << endl;
+}
+
+/**
+ * Demonstrate the opt-in statistics policy
+ */
+void demonstrateStats() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "STATISTICS POLICY DEMONSTRATION" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    // [[no_unique_address]] lets an empty policy occupy no space
+    static_assert(is_empty<NoStats>::value, "NoStats must add no state to containers");
+    
+    Stack<int, NoTrace, 0, allocator<int>, DoublingGrowth, ContainerStats> stack(4);
+    for (int i = 0; i < 100; i++) stack.push(i);
+    for (int i = 0; i < 60; i++) stack.pop();
+    StatsSnapshot s = stack.stats();
+    cout << "Stack: pushes=" << s.insertions << " pops=" << s.removals
+         << " resizes=" << s.resizes << " bytesCopied=" << s.bytesCopied
+         << " highWater=" << s.highWaterMark << endl;
+    
+    // Elements wait in the queue for a varying number of operations
+    RingQueue<int, NoTrace, ContainerStats> queue;
+    for (int round = 0; round < 1000; round++) {
+        queue.enqueue(round);
+        queue.enqueue(round);
+        queue.dequeue();
+    }
+    while (!queue.isEmpty()) queue.dequeue();
+    s = queue.stats();
+    double ticksPerNs = estimateTimestampFrequency() / 1e9;
+    cout << "RingQueue: enqueues=" << s.insertions << " dequeues=" << s.removals
+         << " highWater=" << s.highWaterMark << " latency samples=" << s.latencySamples << endl;
+    cout << fixed << setprecision(0) << "Wait p50 <= " << s.latencyPercentile(50) / ticksPerNs
+         << " ns, p99 <= " << s.latencyPercentile(99) / ticksPerNs << " ns" << endl;
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+}
+
+/**
+ * Demonstrate the constexpr fixed-capacity containers
+ */
+void demonstrateStaticContainers() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "STATIC (CONSTEXPR) STACK AND QUEUE DEMONSTRATION" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    // Computed by the compiler; the binary only holds the results
+    constexpr int compiled = evaluatePostfix("5 1 2 + 4 * + 3 -");
+    constexpr auto survivors = josephusTable<10>(2);
+    cout << "Compile-time postfix \"5 1 2 + 4 * + 3 -\" = " << compiled << endl;
+    cout << "Compile-time Josephus table (k=2):";
+    for (size_t n = 1; n < survivors.size(); n++) cout << " " << survivors[n];
+    cout << endl;
+    
+    // The same code at runtime, with stack-resident storage
+    string runtimeExpr = "8 2 / 3 *";
+    cout << "Runtime postfix \"" << runtimeExpr << "\" = " << evaluatePostfix(runtimeExpr) << endl;
+    
+    StaticQueue<string, 3> recent;
+    for (string name : {"alpha", "beta", "gamma", "delta"}) {
+        if (!recent.try_enqueue(name)) {
+            cout << "Queue full (" << recent.getCapacity() << "), evicting " << recent.dequeue() << endl;
+            recent.enqueue(name);
+        }
+    }
+    cout << "Front after eviction: " << recent.front() << endl;
+    
+    try {
+        evaluatePostfix("1 +");
+    } catch (const runtime_error& e) {
+        cout << "Runtime error caught: " << e.what() << endl;
+    }
+}
+
+/**
+ * Demonstrate compile-once expression evaluation over columnar batches
+ */
+void demonstrateExpressions() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "EXPRESSION EVALUATOR DEMONSTRATION (" << ExprLanes::NAME << " lanes)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    ExpressionCache cache({"price", "tax", "discount", "cap"});
+    const CompiledExpression& total = cache.get("price * (1 + tax) - min(discount, cap)");
+    cout << "Postfix: " << total.toPostfix(cache.columnNames()) << " (depth "
+         << total.stackDepth() << ")" << endl;
+    cout << "Cached: " << boolalpha
+         << (&cache.get("price * (1 + tax) - min(discount, cap)") == &total) << noboolalpha
+         << " (" << cache.size() << " program)" << endl;
+    
+    // One contiguous array per column; 1000 rows evaluated block by block
+    const size_t rows = 1000;
+    vector<double> price(rows), tax(rows), discount(rows), cap(rows), out(rows);
+    for (size_t r = 0; r < rows; r++) {
+        price[r] = 10.0 + static_cast<double>(r % 90);
+        tax[r] = (r % 3) * 0.05;
+        discount[r] = static_cast<double>(r % 7);
+        cap[r] = 4.0;
+    }
+    total.evaluateBatch({price.data(), tax.data(), discount.data(), cap.data()}, rows, out.data());
+    
+    size_t mismatches = 0;
+    for (size_t r = 0; r < rows; r++) {
+        double row[] = {price[r], tax[r], discount[r], cap[r]};
+        if (total.evaluate(row) != out[r]) mismatches++;
+    }
+    cout << "Rows 0-3: " << out[0] << " " << out[1] << " " << out[2] << " " << out[3]
+         << " | batch vs per-row mismatches: " << mismatches << endl;
+    
+    for (const char* bad : {"price * (tax", "price tax", "min(price)", "volume + 1"}) {
+        try {
+            cache.get(bad);
+        } catch (const runtime_error& e) {
+            cout << "\"" << bad << "\" -> " << e.what() << endl;
+        }
+    }
+}
+
+/**
+ * Demonstrate the SPSC queue with one producer and one consumer thread
+ */
+void demonstrateSpscQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "SPSC QUEUE DEMONSTRATION (LOCK-FREE PRODUCER/CONSUMER)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    const long long itemCount = 1000000;
+    SpscQueue<long long> channel(1024);
+    long long consumedSum = 0;
+    
+    // Consumer drains in batches; producer publishes in batches
+    thread consumer([&]() {
+        long long batch[64];
+        long long received = 0;
+        while (received < itemCount) {
+            size_t n = channel.try_dequeue_bulk(batch, 64);
+            for (size_t i = 0; i < n; i++) {
+                consumedSum += batch[i];
+            }
+            received += static_cast<long long>(n);
+        }
+    });
+    
+    long long next = 1;
+    while (next <= itemCount) {
+        long long batch[32];
+        size_t want = 0;
+        for (; want < 32 && next + static_cast<long long>(want) <= itemCount; want++) {
+            batch[want] = next + static_cast<long long>(want);
+        }
+        size_t sent = channel.try_enqueue_bulk(batch, want);
+        next += static_cast<long long>(sent);
+    }
+    consumer.join();
+    
+    long long expected = itemCount * (itemCount + 1) / 2;
+    cout << "Transferred " << itemCount << " items through capacity "
+         << channel.getCapacity() << endl;
+    cout << "Checksum " << (consumedSum == expected ? "matches" : "MISMATCH")
+         << ": " << consumedSum << endl;
+}
+
+#if STACK_QUEUE_HAVE_MMAP
+/**
+ * Demonstrate the mapped queue surviving a detach and being read in place
+ */
+void demonstrateMappedQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "MAPPED QUEUE DEMONSTRATION (FILE-BACKED, ZERO-COPY READS)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    struct Message {
+        uint32_t id;
+        double amount;
+    };
+    const char* tmpdir = getenv("TMPDIR");
+    string path = string(tmpdir != nullptr ? tmpdir : "/tmp") + "/stack_queue_demo." +
+                  to_string(getpid()) + ".mq";
+    
+    // Producer attaches, writes a batch durably, and detaches
+    {
+        MappedQueue<Message> producer(path, 1024, Durability::SyncEachBatch);
+        Message batch[5];
+        for (uint32_t i = 0; i < 5; i++) batch[i] = {i + 1, (i + 1) * 10.5};
+        size_t written = producer.try_enqueue_bulk(batch, 5);
+        cout << "Producer wrote " << written << " messages to " << path << endl;
+    }
+    
+    // A later consumer (could be another process) reads them in place
+    {
+        MappedQueue<Message> consumer(path);
+        cout << "Consumer attached, " << consumer.size() << " messages waiting" << endl;
+        const Message* run;
+        size_t n = consumer.peek_contiguous(run);
+        double total = 0;
+        for (size_t i = 0; i < n; i++) total += run[i].amount;
+        consumer.release(n);
+        cout << "Read " << n << " messages without copying, total amount " << total << endl;
+    }
+    unlink(path.c_str());
+}
+#endif
+
+/**
+ * Demonstrate the spill queue absorbing a burst larger than its budget
+ */
+void demonstrateSpillQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "SPILL QUEUE DEMONSTRATION (RAM BUDGET, DISK-BACKED MIDDLE)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    SpillOptions options;
+    options.memoryBudget = 64 * 1024;
+    options.segmentBytes = 16 * 1024;
+    SpillQueue<uint64_t> events(options);
+    
+    // A burst of 800 KB of events against a 64 KB budget
+    const uint64_t burst = 100000;
+    for (uint64_t id = 0; id < burst; id++) events.enqueue(id);
+    cout << "Queued " << events.size() << " events: " << events.memoryBytes() / 1024
+         << " KB in RAM, " << events.spilledSize() << " spilled to "
+         << events.segmentCount() << " segment files" << endl;
+    
+    // The consumer drains in order while segments stream back
+    uint64_t expected = 0;
+    bool ordered = true;
+    size_t peakBytes = 0;
+    while (!events.isEmpty()) {
+        ordered = ordered && events.dequeue() == expected++;
+        peakBytes = std::max(peakBytes, events.memoryBytes());
+        if (expected == burst / 2) events.enqueue(burst);
+    }
+    cout << "Drained " << expected << " events, FIFO order kept: " << boolalpha << ordered
+         << noboolalpha << ", peak RAM while draining " << peakBytes / 1024 << " KB, "
+         << events.segmentsSpilled() << " segments written" << endl;
+    
+    // Non-trivial types spill through their BinaryCodec
+    SpillOptions small;
+    small.memoryBudget = 256;
+    small.segmentBytes = 256;
+    SpillQueue<string> log(small);
+    for (int i = 0; i < 40; i++) log.enqueue("request-" + to_string(i));
+    string first = log.dequeue();
+    cout << "String queue: " << log.spilledSize() << " of " << log.size() + 1
+         << " spilled, front was " << first << ", next " << log.front() << endl;
+}
+
+/**
+ * Demonstrate the MPMC queue as a shared request queue with backpressure
+ */
+void demonstrateMpmcQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "MPMC QUEUE DEMONSTRATION (REQUEST HANDLERS AND WORKERS)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    const int producerCount = 4;
+    const int consumerCount = 4;
+    const long long perProducer = 100000;
+    MpmcQueue<long long> requests(256);
+    atomic<long long> consumedSum(0);
+    
+    vector<thread> threads;
+    for (int p = 0; p < producerCount; p++) {
+        threads.emplace_back([&, p]() {
+            for (long long i = 1; i <= perProducer; i++) {
+                requests.enqueue(p * perProducer + i);  // Waits when full
+            }
+        });
+    }
+    for (int c = 0; c < consumerCount; c++) {
+        threads.emplace_back([&]() {
+            long long localSum = 0;
+            long long share = producerCount * perProducer / consumerCount;
+            for (long long i = 0; i < share; i++) {
+                localSum += requests.dequeue();  // Waits when empty
+            }
+            consumedSum += localSum;
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    
+    long long total = producerCount * perProducer;
+    long long expected = total * (total + 1) / 2;
+    cout << producerCount << " producers -> " << consumerCount << " consumers, "
+         << total << " items through capacity " << requests.getCapacity() << endl;
+    cout << "Checksum " << (consumedSum == expected ? "matches" : "MISMATCH")
+         << ": " << consumedSum << endl;
+    
+    // A timed dequeue on an empty queue gives up instead of hanging
+    long long item;
+    bool got = requests.try_dequeue_for(item, chrono::milliseconds(10));
+    cout << "Timed dequeue on empty queue: " << (got ? "got item" : "timed out") << endl;
+}
+
+/**
+ * Demonstrate NUMA placement and the sharded queue
+ */
+void demonstrateNumaPlacement() {
     cout << "\n" << string(80, '=') << endl;
-    cout << "STACK DEMONSTRATION (LIFO)" << endl;
+    cout << "NUMA PLACEMENT DEMONSTRATION" << endl;
     cout << string(80, '=') << "\n" << endl;
     
-    Stack<int> intStack(5);
+    cout << "NUMA nodes: " << numaNodeCount() << ", this thread on node " << currentNumaNode() << endl;
     
-    // Push elements
-    cout << "\n--- Pushing elements ---" << endl;
-    intStack.push(10);
-    intStack.push(20);
-    intStack.push(30);
-    intStack.push(40);
-    intStack.push(50);
-    intStack.display();
+    // Queue nodes carved from a pool on node 0 (the consumer's node)
+    NodePool<Node<int>> localPool(0);
+    {
+        Queue<int, NoTrace, ArenaNodeAllocator> queue{ArenaNodeAllocator<Node<int>>(localPool)};
+        for (int i = 0; i < 1000; i++) queue.enqueue(i);
+        cout << "Node-0 pool served 1000 queue nodes from " << localPool.chunkCount() << " chunks" << endl;
+    }
     
-    // Peek at top
-    cout << "\n--- Peek operation ---" << endl;
-    cout << "Top element: " << intStack.peek() << endl;
+    // Two shards even on a single-node box, to show local-first draining
+    NumaShardedQueue<int> sharded(256, 2);
+    for (int i = 0; i < 6; i++) sharded.try_enqueue_on(i % 2, i);
+    int local = cachedNumaNode() % sharded.shardCount();
+    cout << "Shard sizes: " << sharded.shardSize(0) << " + " << sharded.shardSize(1)
+         << "; dequeuing from node " << local << " (local first):";
+    int value;
+    while (sharded.try_dequeue(value)) cout << " " << value;
+    cout << endl;
+}
+
+/**
+ * Demonstrate the per-producer sharded queue
+ */
+void demonstrateShardedQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "SHARDED QUEUE DEMONSTRATION (PER-PRODUCER SPSC SHARDS)" << endl;
+    cout << string(80, '=') << "\n" << endl;
     
-    // Pop elements
-    cout << "\n--- Popping elements ---" << endl;
-    intStack.pop();
-    intStack.pop();
-    intStack.display();
-    cout << "Current size: " << intStack.size() << endl;
+    const int producers = 8;
+    const int perProducer = 20000;
+    ShardedQueue<uint64_t> queue(1024);
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, p, perProducer]() {
+            auto handle = queue.producer();
+            for (int i = 0; i < perProducer; i++) {
+                handle.enqueue(static_cast<uint64_t>(p) << 32 | static_cast<uint64_t>(i));
+            }
+        });
+    }
     
-    // Test resize
-    cout << "\n--- Testing dynamic resize ---" << endl;
-    intStack.push(60);
-    intStack.push(70);
-    intStack.push(80);  // This should trigger resize
-    intStack.display();
+    // Batch-drain and check per-producer FIFO order
+    vector<int64_t> lastSeen(producers, -1);
+    bool ordered = true;
+    long received = 0;
+    vector<uint64_t> batch(256);
+    while (received < static_cast<long>(producers) * perProducer) {
+        size_t n = queue.try_dequeue_bulk(batch.begin(), batch.size());
+        for (size_t i = 0; i < n; i++) {
+            int p = static_cast<int>(batch[i] >> 32);
+            int64_t seq = static_cast<int64_t>(batch[i] & 0xffffffffu);
+            if (seq <= lastSeen[p]) ordered = false;
+            lastSeen[p] = seq;
+        }
+        received += static_cast<long>(n);
+        if (n == 0) this_thread::yield();
+    }
+    for (thread& t : threads) t.join();
+    cout << "Received " << received << " elements from " << queue.shardTotal()
+         << " shards; per-producer FIFO " << (ordered ? "held" : "VIOLATED") << endl;
+}
+
+/**
+ * Demonstrate the blocking queue with sleeping consumers and shutdown
+ */
+void demonstrateBlockingQueue() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "BLOCKING QUEUE DEMONSTRATION (SLEEPING CONSUMERS, CLOSE)" << endl;
+    cout << string(80, '=') << "\n" << endl;
     
-    // String stack example
-    cout << "\n--- String Stack Example ---" << endl;
-    Stack<string> strStack(3);
-    strStack.push("Hello");
-    strStack.push("World");
-    strStack.push("!");
-    strStack.display();
+    BlockingQueue<int> jobs;
+    atomic<long long> processedSum(0);
+    atomic<int> processedCount(0);
+    
+    // Consumers sleep until work arrives and exit once closed and drained
+    vector<thread> consumers;
+    for (int c = 0; c < 3; c++) {
+        consumers.emplace_back([&]() {
+            int batch[16];
+            size_t n;
+            while ((n = jobs.wait_dequeue_bulk(batch, 16)) > 0) {
+                for (size_t i = 0; i < n; i++) processedSum += batch[i];
+                processedCount += static_cast<int>(n);
+            }
+        });
+    }
+    
+    // Bursts of 100 jobs, each burst published with one notification
+    for (int burst = 0; burst < 10; burst++) {
+        vector<int> burstJobs;
+        for (int i = 1; i <= 100; i++) burstJobs.push_back(burst * 100 + i);
+        jobs.enqueue_bulk(burstJobs.begin(), burstJobs.end());
+    }
+    jobs.close();
+    for (thread& t : consumers) {
+        t.join();
+    }
+    cout << "Processed " << processedCount.load() << " jobs, sum " << processedSum.load()
+         << " (expected 500500)" << endl;
+    
+    int leftover;
+    bool got = jobs.wait_dequeue_for(leftover, chrono::milliseconds(10));
+    cout << "Dequeue after close and drain: " << (got ? "got item" : "returns false") << endl;
 }
 
+#if STACK_QUEUE_HAVE_COROUTINES
 /**
- * Demonstrate queue operations
+ * Coroutines for the channel demonstration
  */
-void demonstrateQueue() {
+DetachedTask channelProducer(AsyncChannel<int>& channel, int count, vector<string>& log) {
+    for (int i = 1; i <= count; i++) {
+        log.push_back("produce " + to_string(i));
+        co_await channel.enqueue(i);
+    }
+    log.push_back("producer done, closing");
+    channel.close();
+}
+
+DetachedTask channelConsumer(AsyncChannel<int>& channel, vector<string>& log, int& total) {
+    while (optional<int> item = co_await channel.dequeue()) {
+        log.push_back("  consume " + to_string(*item));
+        total += *item;
+    }
+    log.push_back("  consumer saw close, drained");
+}
+
+/**
+ * Demonstrate the coroutine channel
+ */
+void demonstrateAsyncChannel() {
     cout << "\n" << string(80, '=') << endl;
-    cout << "QUEUE DEMONSTRATION (FIFO)" << endl;
+    cout << "ASYNC CHANNEL DEMONSTRATION (C++20 COROUTINES)" << endl;
     cout << string(80, '=') << "\n" << endl;
     
-    Queue<int> intQueue;
+    // Both coroutines run on this thread; every wakeup is a direct resume
+    AsyncChannel<int> channel(2);
+    vector<string> log;
+    int total = 0;
+    channelConsumer(channel, log, total);   // Suspends: channel is empty
+    channelProducer(channel, 5, log);       // Runs until the consumer drains
+    for (const string& line : log) cout << line << endl;
+    cout << "Total consumed: " << total << endl;
     
-    // Enqueue elements
-    cout << "\n--- Enqueuing elements ---" << endl;
-    intQueue.enqueue(100);
-    intQueue.enqueue(200);
-    intQueue.enqueue(300);
-    intQueue.enqueue(400);
-    intQueue.display();
+    // Producer outpaces the consumer: it suspends once 2 are buffered
+    AsyncChannel<int> bounded(2);
+    log.clear();
+    total = 0;
+    channelProducer(bounded, 4, log);
+    cout << "\nProducer alone: " << log.size() << " produced, " << bounded.size()
+         << " buffered (capacity 2)" << endl;
+    channelConsumer(bounded, log, total);
+    cout << "After consumer: total=" << total << ", closed=" << boolalpha << bounded.isClosed()
+         << noboolalpha << endl;
+}
+#endif
+
+/**
+ * Demonstrate a three-stage batched pipeline
+ */
+void demonstratePipeline() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "PIPELINE DEMONSTRATION (BATCHED STAGES)" << endl;
+    cout << string(80, '=') << "\n" << endl;
     
-    // Front element
-    cout << "\n--- Front operation ---" << endl;
-    cout << "Front element: " << intQueue.front() << endl;
+    // Print-job handling: parse -> render (the slow step, 2 workers) -> spool
+    Pipeline pipe;
+    auto& jobs = pipe.input<int>();
+    auto& parsed = pipe.stage<int, string>("parse", jobs, [](int& id) {
+        return "job-" + to_string(id);
+    });
+    StageOptions renderOptions;
+    renderOptions.workers = 2;
+    renderOptions.batchSize = 32;
+    auto& rendered = pipe.stage<string, size_t>("render", parsed, [](string& job) {
+        size_t hash = 0;
+        for (int round = 0; round < 200; round++) {
+            for (char c : job) hash = hash * 131 + static_cast<size_t>(c) + round;
+        }
+        return hash;
+    }, renderOptions);
+    atomic<uint64_t> spooled{0};
+    // Batch-form sink: one atomic update per batch instead of per job
+    pipe.sink<size_t>("spool", rendered, [&](vector<size_t>& batch) {
+        spooled.fetch_add(batch.size(), memory_order_relaxed);
+    });
     
-    // Dequeue elements
-    cout << "\n--- Dequeuing elements ---" << endl;
-    intQueue.dequeue();
-    intQueue.dequeue();
-    intQueue.display();
-    cout << "Current size: " << intQueue.size() << endl;
+    const int jobCount = 20480;
+    pipe.start();
+    vector<int> ids(256);
+    for (int sent = 0; sent < jobCount; sent += 256) {
+        for (int i = 0; i < 256; i++) ids[i] = sent + i;
+        jobs.push_bulk(ids.data(), ids.size());
+    }
+    pipe.finish();
     
-    // Add more elements
-    cout << "\n--- Adding more elements ---" << endl;
-    intQueue.enqueue(500);
-    intQueue.enqueue(600);
-    intQueue.display();
+    cout << "Spooled " << spooled.load() << " of " << jobCount << " jobs" << endl;
+    cout << left << setw(8) << "stage" << right << setw(8) << "workers" << setw(9) << "items"
+         << setw(9) << "batches" << setw(10) << "busy ms" << setw(12) << "in-stall ms"
+         << setw(13) << "out-stall ms" << endl;
+    cout << fixed << setprecision(1);
+    for (const StageStats& s : pipe.stats()) {
+        cout << left << setw(8) << s.name << right << setw(8) << s.workers << setw(9) << s.items
+             << setw(9) << s.batches << setw(10) << s.busySeconds * 1e3
+             << setw(12) << s.inputStallSeconds * 1e3 << setw(13) << s.outputStallSeconds * 1e3
+             << endl;
+    }
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+}
+
+/**
+ * Demonstrate the lock-free stack as a shared work stack
+ */
+void demonstrateConcurrentStack() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "CONCURRENT STACK DEMONSTRATION (LOCK-FREE LIFO)" << endl;
+    cout << string(80, '=') << "\n" << endl;
     
-    // String queue example
-    cout << "\n--- String Queue Example ---" << endl;
-    Queue<string> strQueue;
-    strQueue.enqueue("First");
-    strQueue.enqueue("Second");
-    strQueue.enqueue("Third");
-    strQueue.display();
-    strQueue.dequeue();
-    strQueue.display();
+    const int threadCount = 4;
+    const long long perThread = 50000;
+    ConcurrentStack<long long> workStack;
+    atomic<long long> poppedSum(0);
+    
+    // Every thread pushes its own items and pops whatever is on top
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            long long localSum = 0;
+            long long item;
+            for (long long i = 1; i <= perThread; i++) {
+                workStack.push(t * perThread + i);
+                if (i % 2 == 0 && workStack.try_pop(item)) {
+                    localSum += item;
+                }
+            }
+            poppedSum += localSum;
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    
+    // Steal everything that is left in one exchange
+    vector<long long> rest;
+    size_t stolen = workStack.pop_all(back_inserter(rest));
+    long long restSum = 0;
+    for (long long v : rest) restSum += v;
+    
+    long long total = threadCount * perThread;
+    long long expected = total * (total + 1) / 2;
+    cout << "pop_all took " << stolen << " remaining items" << endl;
+    cout << "Checksum " << (poppedSum + restSum == expected ? "matches" : "MISMATCH")
+         << ": " << poppedSum + restSum << endl;
+}
+
+/**
+ * Count N-Queens solutions from a partial board (bitmask backtracking)
+ * Forks one task per candidate column until depth reaches splitDepth,
+ * then finishes the subtree sequentially
+ */
+void countQueens(TaskScheduler& scheduler, int n, int row, unsigned cols,
+                 unsigned diag1, unsigned diag2, int splitDepth, atomic<long>& solutions) {
+    if (row == n) {
+        solutions.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    unsigned all = (1u << n) - 1;
+    unsigned free = all & ~(cols | diag1 | diag2);
+    if (row >= splitDepth) {
+        while (free) {
+            unsigned bit = free & (0u - free);
+            free ^= bit;
+            countQueens(scheduler, n, row + 1, cols | bit, (diag1 | bit) << 1,
+                        (diag2 | bit) >> 1, splitDepth, solutions);
+        }
+        return;
+    }
+    TaskGroup group(scheduler);
+    while (free) {
+        unsigned bit = free & (0u - free);
+        free ^= bit;
+        group.run([&scheduler, &solutions, n, row, cols, diag1, diag2, splitDepth, bit]() {
+            countQueens(scheduler, n, row + 1, cols | bit, (diag1 | bit) << 1,
+                        (diag2 | bit) >> 1, splitDepth, solutions);
+        });
+    }
+    group.wait();
+}
+
+/**
+ * Demonstrate the work-stealing scheduler on parallel backtracking
+ */
+void demonstrateTaskScheduler() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "WORK-STEALING SCHEDULER DEMONSTRATION (PARALLEL BACKTRACKING)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    TaskScheduler scheduler;
+    const int boardSize = 10;
+    atomic<long> solutions(0);
+    countQueens(scheduler, boardSize, 0, 0, 0, 0, 3, solutions);
+    cout << boardSize << "-Queens on " << scheduler.workerCount() << " workers: "
+         << solutions.load() << " solutions (expected 724)" << endl;
+}
+
+/**
+ * Demonstrate parallel BFS against a sequential RingQueue BFS
+ */
+void demonstrateParallelBfs() {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "PARALLEL BFS DEMONSTRATION (DIRECTION-OPTIMIZING)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    
+    // Random undirected graph: average degree 16 (pseudo-random, repeatable)
+    const int32_t vertexCount = 100000;
+    vector<pair<int32_t, int32_t>> edges;
+    uint64_t seed = 88172645463325252ull;
+    for (int64_t i = 0; i < int64_t(vertexCount) * 8; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        edges.emplace_back(static_cast<int32_t>(seed % vertexCount),
+                           static_cast<int32_t>((seed >> 32) % vertexCount));
+    }
+    CsrGraph graph = CsrGraph::fromEdges(vertexCount, edges, true);
+    
+    // Sequential reference using the contiguous queue as the frontier
+    vector<int32_t> expected(vertexCount, -1);
+    RingQueue<int32_t> frontier;
+    expected[0] = 0;
+    frontier.enqueue(0);
+    while (!frontier.isEmpty()) {
+        int32_t u = frontier.dequeue();
+        for (int64_t e = graph.offsets[u]; e < graph.offsets[u + 1]; e++) {
+            int32_t v = graph.neighbors[e];
+            if (expected[v] < 0) {
+                expected[v] = expected[u] + 1;
+                frontier.enqueue(v);
+            }
+        }
+    }
+    
+    TaskScheduler scheduler;
+    ParallelBfs bfs(scheduler);
+    vector<int32_t> depth = bfs.run(graph, 0);
+    
+    int32_t maxDepth = 0;
+    for (int32_t d : depth) maxDepth = d > maxDepth ? d : maxDepth;
+    cout << vertexCount << " vertices, " << graph.edgeCount() << " directed edges, "
+         << "depth " << maxDepth << endl;
+    cout << "Parallel result " << (depth == expected ? "matches" : "DIFFERS FROM")
+         << " sequential BFS" << endl;
 }
 
 /**
@@ -374,8 +9252,8 @@ void demonstrateErrorHandling() {
     cout << "ERROR HANDLING DEMONSTRATION" << endl;
     cout << string(80, '=') << "\n" << endl;
     
-    Stack<int> emptyStack(2);
-    Queue<int> emptyQueue;
+    Stack<int, ConsoleTrace> emptyStack(2);
+    Queue<int, ConsoleTrace> emptyQueue;
     
     // Test stack underflow
     cout << "\n--- Testing Stack Underflow ---" << endl;
@@ -400,18 +9278,446 @@ void demonstrateErrorHandling() {
     } catch (const runtime_error& e) {
         cout << "Caught exception: " << e.what() << endl;
     }
+    
+    // Non-throwing alternatives for polling loops
+    cout << "\n--- Non-throwing fast path ---" << endl;
+    int value;
+    cout << "try_pop on empty stack: " << (emptyStack.try_pop(value) ? "true" : "false") << endl;
+    cout << "dequeue_optional on empty queue has value: "
+         << (emptyQueue.dequeue_optional().has_value() ? "true" : "false") << endl;
+    emptyStack.push(42);
+    if (!emptyStack.isEmpty()) {
+        cout << "Unchecked top after isEmpty() check: " << emptyStack.top() << endl;
+        emptyStack.pop_unchecked();
+    }
+}
+
+// ============================================================================
+// MICRO-BENCHMARKS
+// ============================================================================
+
+/**
+ * 64-byte payload used to measure copying of a full cache line per element
+ */
+struct Payload64 {
+    uint64_t words[8];
+    
+    bool operator<(const Payload64& other) const {
+        return words[0] < other.words[0];
+    }
+    
+    bool operator>(const Payload64& other) const {
+        return words[0] > other.words[0];
+    }
+    
+    // Printed by display() and ConsoleTrace as its first word
+    friend ostream& operator<<(ostream& out, const Payload64& value) {
+        return out << "payload#" << value.words[0];
+    }
+};
+
+/**
+ * Sample values, generated up front so value construction is not timed
+ */
+template <typename T>
+vector<T> makeBenchValues();
+
+template <>
+vector<int> makeBenchValues<int>() {
+    vector<int> values(1024);
+    for (int i = 0; i < 1024; i++) values[i] = i;
+    return values;
+}
+
+template <>
+vector<string> makeBenchValues<string>() {
+    vector<string> values(1024);
+    for (int i = 0; i < 1024; i++) {
+        values[i] = "request-" + to_string(i) + string(24, 'x');  // Beyond SSO
+    }
+    return values;
+}
+
+template <>
+vector<Payload64> makeBenchValues<Payload64>() {
+    vector<Payload64> values(1024);
+    for (int i = 0; i < 1024; i++) {
+        for (int w = 0; w < 8; w++) values[i].words[w] = i * 8 + w;
+    }
+    return values;
+}
+
+/**
+ * Fold a dequeued value into a checksum so the work cannot be optimized out
+ */
+inline uint64_t benchDigest(int v) { return static_cast<uint64_t>(v); }
+inline uint64_t benchDigest(const string& v) { return v.size(); }
+inline uint64_t benchDigest(const Payload64& v) { return v.words[0]; }
+
+/**
+ * Aggregate timing for one workload
+ */
+struct BenchResult {
+    double nsPerOp;
+    double opsPerSec;
+    double p50;          // Sampled single-operation latency (ns)
+    double p99;
+    double p999;
+};
+
+volatile uint64_t benchSink = 0;  // Published checksum
+
+/**
+ * Measure: Run op(i) for i in [0, ops) and time it
+ * Every LATENCY_SAMPLE_EVERY-th operation is also timed on its own to
+ * build the latency distribution; sampled latencies include the cost of
+ * reading the clock (typically ~20 ns).
+ */
+template <typename Op>
+BenchResult measure(size_t ops, Op op) {
+    const size_t LATENCY_SAMPLE_EVERY = 64;
+    vector<double> samples;
+    samples.reserve(ops / LATENCY_SAMPLE_EVERY + 1);
+    
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; i++) {
+        if (i % LATENCY_SAMPLE_EVERY == 0) {
+            auto t0 = chrono::steady_clock::now();
+            op(i);
+            auto t1 = chrono::steady_clock::now();
+            samples.push_back(chrono::duration<double, nano>(t1 - t0).count());
+        } else {
+            op(i);
+        }
+    }
+    auto end = chrono::steady_clock::now();
+    
+    double totalNs = chrono::duration<double, nano>(end - start).count();
+    BenchResult result;
+    result.nsPerOp = ops > 0 ? totalNs / ops : 0.0;
+    result.opsPerSec = totalNs > 0 ? ops * 1e9 / totalNs : 0.0;
+    sort(samples.begin(), samples.end());
+    auto percentile = [&](double q) {
+        if (samples.empty()) return 0.0;
+        return samples[static_cast<size_t>(q * (samples.size() - 1))];
+    };
+    result.p50 = percentile(0.50);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+    return result;
+}
+
+/**
+ * Print one row of the results table
+ */
+void printBenchRow(const string& container, const string& typeName, size_t n,
+                   const string& workload, const BenchResult& r) {
+    cout << left << setw(22) << container << setw(10) << typeName
+         << right << setw(11) << n << "  " << left << setw(9) << workload
+         << right << fixed << setprecision(2)
+         << setw(9) << r.nsPerOp << setw(10) << r.opsPerSec / 1e6
+         << setprecision(0)
+         << setw(8) << r.p50 << setw(8) << r.p99 << setw(9) << r.p999 << endl;
+}
+
+/**
+ * Adapters giving every container the same push/pop vocabulary
+ */
+template <typename S, typename T>
+void benchPush(S& s, const T& v) { s.push(v); }
+
+template <typename S>
+uint64_t benchPop(S& s) { return benchDigest(s.pop()); }
+
+template <typename T>
+uint64_t benchPop(stack<T>& s) {
+    uint64_t d = benchDigest(s.top());
+    s.pop();
+    return d;
+}
+
+template <typename Q, typename T>
+void benchEnqueue(Q& q, const T& v) { q.enqueue(v); }
+
+template <typename Q>
+uint64_t benchDequeue(Q& q) { return benchDigest(q.dequeue()); }
+
+template <typename T>
+void benchEnqueue(queue<T>& q, const T& v) { q.push(v); }
+
+template <typename T>
+uint64_t benchDequeue(queue<T>& q) {
+    uint64_t d = benchDigest(q.front());
+    q.pop();
+    return d;
+}
+
+template <typename T>
+void benchEnqueue(deque<T>& q, const T& v) { q.push_back(v); }
+
+template <typename T>
+uint64_t benchDequeue(deque<T>& q) {
+    uint64_t d = benchDigest(q.front());
+    q.pop_front();
+    return d;
+}
+
+/**
+ * Stack workloads: n pushes, then n pops
+ */
+template <typename S, typename T>
+void benchStack(const string& container, const string& typeName, size_t n) {
+    vector<T> values = makeBenchValues<T>();
+    S s;
+    uint64_t digest = 0;
+    printBenchRow(container, typeName, n, "push",
+                  measure(n, [&](size_t i) { benchPush(s, values[i & 1023]); }));
+    printBenchRow(container, typeName, n, "pop",
+                  measure(n, [&](size_t) { digest += benchPop(s); }));
+    benchSink = benchSink + digest;
+}
+
+/**
+ * Queue workloads: n enqueues, n dequeues, then a steady-state mix that
+ * alternates enqueue and dequeue around a 1024-element backlog
+ */
+template <typename Q, typename T>
+void benchQueue(const string& container, const string& typeName, size_t n) {
+    vector<T> values = makeBenchValues<T>();
+    Q q;
+    uint64_t digest = 0;
+    printBenchRow(container, typeName, n, "enqueue",
+                  measure(n, [&](size_t i) { benchEnqueue(q, values[i & 1023]); }));
+    printBenchRow(container, typeName, n, "dequeue",
+                  measure(n, [&](size_t) { digest += benchDequeue(q); }));
+    for (size_t i = 0; i < 1024; i++) benchEnqueue(q, values[i]);
+    printBenchRow(container, typeName, n, "mixed",
+                  measure(n, [&](size_t i) {
+                      if (i & 1) {
+                          digest += benchDequeue(q);
+                      } else {
+                          benchEnqueue(q, values[i & 1023]);
+                      }
+                  }));
+    benchSink = benchSink + digest;
+}
+
+/**
+ * Priority queue workloads: n pushes of shuffled values, then n pops
+ */
+template <typename T>
+void benchPriority(const string& typeName, size_t n) {
+    vector<T> values = makeBenchValues<T>();
+    // Scramble the order so pushes do not arrive pre-sorted
+    for (size_t i = 0; i < values.size(); i++) {
+        swap(values[i], values[(i * 7919) & 1023]);
+    }
+    uint64_t digest = 0;
+    {
+        DaryHeap<T> heap;
+        printBenchRow("DaryHeap (4-ary)", typeName, n, "push",
+                      measure(n, [&](size_t i) { heap.push(values[i & 1023]); }));
+        printBenchRow("DaryHeap (4-ary)", typeName, n, "pop",
+                      measure(n, [&](size_t) { digest += benchDigest(heap.pop()); }));
+    }
+    {
+        // greater<T> makes std::priority_queue a min-heap like DaryHeap
+        priority_queue<T, vector<T>, greater<T>> heap;
+        printBenchRow("std::priority_queue", typeName, n, "push",
+                      measure(n, [&](size_t i) { heap.push(values[i & 1023]); }));
+        printBenchRow("std::priority_queue", typeName, n, "pop",
+                      measure(n, [&](size_t) {
+                          digest += benchDigest(heap.top());
+                          heap.pop();
+                      }));
+    }
+    benchSink = benchSink + digest;
+}
+
+/**
+ * Search workloads over n ints: each op is one full count() scan, so
+ * ns/op is the cost of a scan, not of one element
+ */
+void benchSearch(size_t n) {
+    const size_t scans = 16;
+    uint64_t digest = 0;
+    {
+        Stack<int> stack;
+        for (size_t i = 0; i < n; i++) stack.push(static_cast<int>(i & 1023));
+        printBenchRow("Stack", "int", n, "count",
+                      measure(scans, [&](size_t i) { digest += stack.count(static_cast<int>(i)); }));
+        printBenchRow("Stack", "int", n, "sum",
+                      measure(scans, [&](size_t) { digest += static_cast<uint64_t>(stack.sum()); }));
+    }
+    {
+        ChunkedQueue<int> chunked;
+        for (size_t i = 0; i < n; i++) chunked.enqueue(static_cast<int>(i & 1023));
+        printBenchRow("ChunkedQueue", "int", n, "count",
+                      measure(scans, [&](size_t i) { digest += chunked.count(static_cast<int>(i)); }));
+    }
+    {
+        deque<int> reference;
+        for (size_t i = 0; i < n; i++) reference.push_back(static_cast<int>(i & 1023));
+        printBenchRow("std::count (deque)", "int", n, "count",
+                      measure(scans, [&](size_t i) {
+                          digest += static_cast<uint64_t>(
+                              std::count(reference.begin(), reference.end(), static_cast<int>(i)));
+                      }));
+    }
+    benchSink = benchSink + digest;
+}
+
+/**
+ * Expression workloads over n rows of four columns: each timed op is one
+ * full pass, reported per row. "reparse" compiles the formula for every
+ * row (capped at 100,000 rows), "per-row" interprets a cached program on
+ * a Stack per row, "batch" runs it over columnar blocks.
+ */
+void benchExpressions(size_t n) {
+    const size_t passes = 4;
+    const char* formula = "price * (1 + tax) - min(discount, cap)";
+    vector<string> names = {"price", "tax", "discount", "cap"};
+    vector<vector<double>> columns(names.size(), vector<double>(n));
+    for (size_t r = 0; r < n; r++) {
+        for (size_t c = 0; c < names.size(); c++) columns[c][r] = static_cast<double>((r + c) & 1023);
+    }
+    vector<const double*> pointers;
+    for (const vector<double>& column : columns) pointers.push_back(column.data());
+    vector<double> out(n);
+    CompiledExpression compiled(formula, names);
+    double digest = 0.0;
+    
+    auto perRow = [](BenchResult r, size_t rows) {
+        double scale = static_cast<double>(rows);
+        r.nsPerOp /= scale;
+        r.opsPerSec *= scale;
+        r.p50 /= scale;
+        r.p99 /= scale;
+        r.p999 /= scale;
+        return r;
+    };
+    auto row = [&](size_t r) {
+        return array<double, 4>{columns[0][r], columns[1][r], columns[2][r], columns[3][r]};
+    };
+    size_t reparseRows = std::min<size_t>(n, 100000);
+    printBenchRow("Expression", "double", reparseRows, "reparse",
+                  perRow(measure(passes, [&](size_t) {
+                      for (size_t r = 0; r < reparseRows; r++) {
+                          digest += CompiledExpression(formula, names).evaluate(row(r).data());
+                      }
+                  }), reparseRows));
+    printBenchRow("Expression", "double", n, "per-row",
+                  perRow(measure(passes, [&](size_t) {
+                      for (size_t r = 0; r < n; r++) digest += compiled.evaluate(row(r).data());
+                  }), n));
+    printBenchRow(string("Expression (") + ExprLanes::NAME + ")", "double", n, "batch",
+                  perRow(measure(passes, [&](size_t) {
+                      compiled.evaluateBatch(pointers, n, out.data());
+                      digest += out[n / 2];
+                  }), n));
+    benchSink = benchSink + static_cast<uint64_t>(digest);
+}
+
+/**
+ * Run every container for one element type and size
+ */
+template <typename T>
+void benchAllContainers(const string& typeName, size_t n) {
+    benchStack<Stack<T>, T>("Stack", typeName, n);
+    benchStack<stack<T>, T>("std::stack", typeName, n);
+    benchQueue<Queue<T>, T>("Queue (linked)", typeName, n);
+    benchQueue<Queue<T, NoTrace, PooledNodeAllocator>, T>("Queue (pooled nodes)", typeName, n);
+    benchQueue<RingQueue<T>, T>("RingQueue", typeName, n);
+    benchQueue<ChunkedQueue<T>, T>("ChunkedQueue", typeName, n);
+    benchQueue<queue<T>, T>("std::queue", typeName, n);
+    benchQueue<deque<T>, T>("std::deque", typeName, n);
+    benchPriority<T>(typeName, n);
+}
+
+/**
+ * Benchmark entry point: ./stack_queue --benchmark [max_elements]
+ * Runs each fixed step (1,000, 100,000, 1M, 10M, 100M) below max_elements
+ * and then max_elements itself (default 1,000,000; 100M string elements
+ * need several GB).
+ */
+void runBenchmarks(size_t maxElements) {
+    cout << "\n" << string(80, '=') << endl;
+    cout << "MICRO-BENCHMARKS (up to " << maxElements << " elements)" << endl;
+    cout << string(80, '=') << "\n" << endl;
+    cout << left << setw(22) << "container" << setw(10) << "type"
+         << right << setw(11) << "elements" << "  " << left << setw(9) << "workload"
+         << right << setw(9) << "ns/op" << setw(10) << "Mops/s"
+         << setw(8) << "p50" << setw(8) << "p99" << setw(9) << "p999" << endl;
+    cout << string(96, '-') << endl;
+    
+    const size_t steps[] = {1000, 100000, 1000000, 10000000, 100000000};
+    vector<size_t> sizes;
+    for (size_t n : steps) {
+        if (n < maxElements) sizes.push_back(n);
+    }
+    sizes.push_back(maxElements);
+    for (size_t n : sizes) {
+        benchAllContainers<int>("int", n);
+        benchSearch(n);
+        benchExpressions(n);
+        benchAllContainers<string>("string", n);
+        benchAllContainers<Payload64>("64B", n);
+    }
+    cout << "\n(latency percentiles in ns, sampled 1 op in 64; checksum "
+         << benchSink << ")" << endl;
 }
 
 /**
  * Main function: Run all demonstrations
+ * Pass --benchmark [max_elements] to run the micro-benchmarks instead
  */
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--benchmark") {
+        size_t maxElements = 1000000;
+        if (argc > 2) {
+            // from_chars rejects signs and junk that stoull would accept or throw on
+            string_view arg(argv[2]);
+            auto parsed = from_chars(arg.data(), arg.data() + arg.size(), maxElements);
+            if (parsed.ec != errc() || parsed.ptr != arg.data() + arg.size() || maxElements == 0) {
+                cerr << "Usage: " << argv[0] << " --benchmark [maxElements > 0]" << endl;
+                return 1;
+            }
+        }
+        runBenchmarks(maxElements);
+        return 0;
+    }
+    
     cout << "\n" << string(80, '=') << endl;
     cout << "DATA STRUCTURES: STACK AND QUEUE IMPLEMENTATION" << endl;
     cout << string(80, '=') << endl;
     
     demonstrateStack();
     demonstrateQueue();
+    demonstrateRingQueue();
+    demonstrateChunkedQueue();
+    demonstrateIntrusiveContainers();
+    demonstratePersistentContainers();
+    demonstratePriorityQueues();
+    demonstrateSearch();
+    demonstrateStats();
+    demonstrateStaticContainers();
+    demonstrateExpressions();
+    demonstrateSpscQueue();
+#if STACK_QUEUE_HAVE_MMAP
+    demonstrateMappedQueue();
+#endif
+    demonstrateSpillQueue();
+    demonstrateMpmcQueue();
+    demonstrateNumaPlacement();
+    demonstrateShardedQueue();
+    demonstrateBlockingQueue();
+#if STACK_QUEUE_HAVE_COROUTINES
+    demonstrateAsyncChannel();
+#endif
+    demonstratePipeline();
+    demonstrateConcurrentStack();
+    demonstrateTaskScheduler();
+    demonstrateParallelBfs();
     demonstrateErrorHandling();
     
     cout << "\n" << string(80, '=') << endl;